@@ -0,0 +1,349 @@
+#ifndef LIBBEAR_CORE_CACHE_H
+#define LIBBEAR_CORE_CACHE_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <libbear/core/hash.h>
+#include <libbear/core/thread.h>
+
+namespace libbear {
+
+  enum class eviction_policy {
+    lru,      // least recently used entry is evicted first
+    clock,    // second chance approximation of LRU, hits do not reorder
+    keep_best // entry with the smallest value is evicted first
+  };
+
+  struct cache_options {
+    static constexpr std::size_t unlimited{
+      std::numeric_limits<std::size_t>::max()
+    };
+
+    std::size_t max_entries{unlimited};
+    std::size_t max_bytes{unlimited};
+    eviction_policy policy{eviction_policy::lru};
+  };
+
+  struct cache_statistics {
+    std::size_t hits{0};
+    std::size_t misses{0};
+    std::size_t evictions{0};
+    std::size_t entries{0};
+    std::size_t bytes{0};
+    // Lookups which awaited value being computed concurrently.
+    std::size_t awaited{0};
+  };
+
+  // Associative container of bounded size. Size in bytes is estimated with
+  // weight function, which should return memory owned by key and value
+  // outside of the objects themselves.
+  template<typename K, typename V, typename Hash = std::hash<K>>
+  class cache {
+  public:
+    using weight_fn = std::function<std::size_t(const K&, const V&)>;
+
+  private:
+    using order = std::list<const K*>;
+    using ranks = std::multimap<V, const K*>;
+
+    struct entry {
+      V value;
+      std::size_t weight;
+      bool referenced{false};
+      typename order::iterator position{};
+      typename ranks::iterator rank{};
+    };
+
+    using map = std::unordered_map<K, entry, Hash>;
+
+  public:
+    explicit cache(const cache_options& o = cache_options{},
+                   const weight_fn& w = [](const K&, const V&) { return 0; })
+      : options_{o}, weight_{w}
+    {}
+
+    cache(const cache&) = delete;
+    cache& operator=(const cache&) = delete;
+
+    std::size_t size() const { return map_.size(); }
+    const cache_options& options() const { return options_; }
+    const cache_statistics& statistics() const { return statistics_; }
+    bool contains(const K& k) const { return map_.contains(k); }
+
+    // Lookup which affects neither statistics nor eviction order.
+    std::optional<V> peek(const K& k) const {
+      const auto it = map_.find(k);
+      return it == map_.end() ? std::nullopt : std::optional{it->second.value};
+    }
+
+    std::optional<V> find(const K& k) {
+      const auto it = map_.find(k);
+      if (it == map_.end()) {
+        ++statistics_.misses;
+        return std::nullopt;
+      }
+      ++statistics_.hits;
+      touch(it->second);
+      return it->second.value;
+    }
+
+    void insert(const K& k, const V& v) {
+      if (const auto it = map_.find(k); it != map_.end()) {
+        erase(it);
+      }
+      const std::size_t w =
+        sizeof(typename map::value_type) + sizeof(K*) + weight_(k, v);
+      auto [it, _] = map_.emplace(k, entry{v, w});
+      const K* key = &it->first;
+      auto& e = it->second;
+      switch (options_.policy) {
+      case eviction_policy::lru:
+        e.position = order_.insert(order_.begin(), key);
+        break;
+      case eviction_policy::clock:
+        e.position = order_.insert(hand_, key);
+        break;
+      case eviction_policy::keep_best:
+        e.rank = ranks_.emplace(v, key);
+        break;
+      }
+      statistics_.bytes += w;
+      statistics_.entries = map_.size();
+      while (!map_.empty()
+             && (map_.size() > options_.max_entries
+                 || statistics_.bytes > options_.max_bytes)) {
+        evict();
+      }
+    }
+
+  private:
+    void touch(entry& e) {
+      switch (options_.policy) {
+      case eviction_policy::lru:
+        order_.splice(order_.begin(), order_, e.position);
+        break;
+      case eviction_policy::clock:
+        e.referenced = true;
+        break;
+      case eviction_policy::keep_best:
+        break;
+      }
+    }
+
+    const K* victim() {
+      switch (options_.policy) {
+      case eviction_policy::lru:
+        return order_.back();
+      case eviction_policy::clock:
+        for (;; ++hand_) {
+          if (hand_ == order_.end()) {
+            hand_ = order_.begin();
+          }
+          auto& e = map_.find(**hand_)->second;
+          if (!e.referenced) {
+            return *hand_;
+          }
+          e.referenced = false;
+        }
+      case eviction_policy::keep_best:
+        break;
+      }
+      return ranks_.begin()->second;
+    }
+
+    void evict() {
+      erase(map_.find(*victim()));
+      ++statistics_.evictions;
+    }
+
+    void erase(typename map::iterator it) {
+      auto& e = it->second;
+      if (options_.policy == eviction_policy::keep_best) {
+        ranks_.erase(e.rank);
+      } else {
+        if (hand_ == e.position) {
+          ++hand_;
+        }
+        order_.erase(e.position);
+      }
+      statistics_.bytes -= e.weight;
+      map_.erase(it);
+      statistics_.entries = map_.size();
+    }
+
+  private:
+    const cache_options options_;
+    const weight_fn weight_;
+    map map_{};
+    order order_{};
+    typename order::iterator hand_{order_.end()};
+    ranks ranks_{};
+    cache_statistics statistics_{};
+  };
+
+  // Cache safe for concurrent use. Keys are distributed among independently
+  // locked shards, so threads working on different keys rarely contend.
+  // Shards are guarded by spin_lock, as they are locked only for lookups and
+  // insertions, never for computations.
+  // Capacity limits are split evenly between shards, thus eviction decisions
+  // are local to a shard.
+  template<typename K, typename V, typename Hash = std::hash<K>>
+  class concurrent_cache {
+  public:
+    using weight_fn = typename cache<K, V, Hash>::weight_fn;
+    static constexpr std::size_t default_shards{16};
+
+  private:
+    struct alignas(64) shard {
+      shard(const cache_options& o, const weight_fn& w) : c{o, w} {}
+
+      spin_lock m{};
+      cache<K, V, Hash> c;
+      // Values being computed at the moment.
+      std::unordered_map<K, std::shared_future<V>, Hash> pending{};
+      std::size_t awaited{0};
+    };
+
+  public:
+    explicit concurrent_cache(const cache_options& o = cache_options{},
+                              const weight_fn& w =
+                                [](const K&, const V&) { return 0; },
+                              std::size_t shards = default_shards)
+      : options_{o}
+    {
+      // Number of shards is a power of two not greater than entry limit.
+      const std::size_t n = std::bit_floor(
+        std::max<std::size_t>(1, std::min(shards, o.max_entries)));
+      const auto split = [n](std::size_t x, std::size_t i) {
+        return x == cache_options::unlimited ? x : x / n + (i < x % n);
+      };
+      shift_ = 64 - std::countr_zero(n);
+      shards_.reserve(n);
+      for (std::size_t i = 0; i < n; ++i) {
+        const cache_options so{split(o.max_entries, i),
+                               split(o.max_bytes, i), o.policy};
+        shards_.push_back(std::make_unique<shard>(so, w));
+      }
+    }
+
+    concurrent_cache(const concurrent_cache&) = delete;
+    concurrent_cache& operator=(const concurrent_cache&) = delete;
+
+    const cache_options& options() const { return options_; }
+    std::size_t shards() const { return shards_.size(); }
+
+    std::size_t size() const {
+      std::size_t res{0};
+      for (const auto& s : shards_) {
+        std::lock_guard<spin_lock> lg{s->m};
+        res += s->c.size();
+      }
+      return res;
+    }
+
+    cache_statistics statistics() const {
+      cache_statistics res{};
+      for (const auto& s : shards_) {
+        std::lock_guard<spin_lock> lg{s->m};
+        const auto& x = s->c.statistics();
+        res.hits += x.hits;
+        res.misses += x.misses;
+        res.evictions += x.evictions;
+        res.entries += x.entries;
+        res.bytes += x.bytes;
+        res.awaited += s->awaited;
+      }
+      return res;
+    }
+
+    bool contains(const K& k) const {
+      auto& s = at(k);
+      std::lock_guard<spin_lock> lg{s.m};
+      return s.c.contains(k);
+    }
+
+    std::optional<V> find(const K& k) {
+      auto& s = at(k);
+      std::lock_guard<spin_lock> lg{s.m};
+      return s.c.find(k);
+    }
+
+    void insert(const K& k, const V& v) {
+      auto& s = at(k);
+      std::lock_guard<spin_lock> lg{s.m};
+      s.c.insert(k, v);
+    }
+
+    // Computes f() and caches it as value of k, unless k is already cached
+    // or being computed by other thread. In the latter case the result of
+    // the running computation is awaited, so f is called at most once at a
+    // time for any key. Lookups done here are not counted in statistics, as
+    // compute is meant to follow unsuccessful find.
+    template<typename F>
+    V compute(const K& k, F f) {
+      auto& s = at(k);
+      std::unique_lock<spin_lock> ul{s.m};
+      if (const auto v = s.c.peek(k)) {
+        return *v;
+      }
+      if (const auto it = s.pending.find(k); it != s.pending.end()) {
+        ++s.awaited;
+        const auto sf = it->second;
+        ul.unlock();
+        return sf.get();
+      }
+      std::promise<V> p{};
+      s.pending.emplace(k, p.get_future().share());
+      ul.unlock();
+      try {
+        const V v = f();
+        ul.lock();
+        s.c.insert(k, v);
+        s.pending.erase(k);
+        ul.unlock();
+        p.set_value(v);
+        return v;
+      } catch (...) {
+        if (!ul.owns_lock()) {
+          ul.lock();
+        }
+        s.pending.erase(k);
+        ul.unlock();
+        p.set_exception(std::current_exception());
+        throw;
+      }
+    }
+
+  private:
+    // Shard is chosen by the most significant bits of hash, while buckets of
+    // unordered_map inside the shard are chosen rather by the least
+    // significant ones. Hash is mixed first, as e.g. std::hash of integers
+    // is identity and its high bits are zero.
+    shard& at(const K& k) const {
+      const std::uint64_t h = hasher{}(Hash{}(k)).digest();
+      return *shards_[shift_ == 64 ? 0 : h >> shift_];
+    }
+
+  private:
+    const cache_options options_;
+    int shift_;
+    std::vector<std::unique_ptr<shard>> shards_{};
+  };
+
+} // namespace libbear
+
+#endif // LIBBEAR_CORE_CACHE_H
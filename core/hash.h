@@ -0,0 +1,50 @@
+#ifndef LIBBEAR_CORE_HASH_H
+#define LIBBEAR_CORE_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace libbear {
+
+  // Incremental hash of a sequence of 64-bit words. Words are combined like
+  // 8-byte lanes in XXH64 [Y. Collet, xxHash], which makes the result depend
+  // on both values and order of words, and finally avalanched.
+  class hasher {
+  private:
+    static constexpr std::uint64_t prime1{0x9E3779B185EBCA87};
+    static constexpr std::uint64_t prime2{0xC2B2AE3D27D4EB4F};
+    static constexpr std::uint64_t prime3{0x165667B19E3779F9};
+    static constexpr std::uint64_t prime4{0x85EBCA77C2B2AE63};
+    static constexpr std::uint64_t prime5{0x27D4EB2F165667C5};
+
+    static constexpr std::uint64_t rotl(std::uint64_t x, int r)
+    { return (x << r) | (x >> (64 - r)); }
+
+  public:
+    constexpr explicit hasher(std::uint64_t seed = 0) : acc_{seed + prime5} {}
+
+    constexpr hasher& operator()(std::uint64_t x) {
+      acc_ ^= rotl(x * prime2, 31) * prime1;
+      acc_ = rotl(acc_, 27) * prime1 + prime4;
+      ++size_;
+      return *this;
+    }
+
+    constexpr std::uint64_t digest() const {
+      std::uint64_t h = acc_ + size_ * 8;
+      h ^= h >> 33;
+      h *= prime2;
+      h ^= h >> 29;
+      h *= prime3;
+      h ^= h >> 32;
+      return h;
+    }
+
+  private:
+    std::uint64_t acc_;
+    std::uint64_t size_{0};
+  };
+
+} // namespace libbear
+
+#endif // LIBBEAR_CORE_HASH_H
@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <libbear/core/histogram.h>
+
+void
+libbear::histogram::
+record(std::uint64_t v) {
+  counts_[index(v)].fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(v, std::memory_order_relaxed);
+  for (auto m = min_.load(); v < m && !min_.compare_exchange_weak(m, v););
+  for (auto m = max_.load(); v > m && !max_.compare_exchange_weak(m, v););
+  count_.fetch_add(1, std::memory_order_release);
+}
+
+double
+libbear::histogram::
+mean() const {
+  const auto n = count();
+  return n == 0 ? 0. : static_cast<double>(sum_.load()) / n;
+}
+
+std::uint64_t
+libbear::histogram::
+percentile(double p) const {
+  const auto n = count();
+  if (n == 0) {
+    return 0;
+  }
+  const double q = std::clamp(p, 0., 100.) / 100.;
+  const auto rank =
+    std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(q * n)));
+  std::uint64_t seen{0};
+  for (std::size_t i = 0; i < buckets; ++i) {
+    seen += counts_[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      return std::clamp(highest(i), min(), max());
+    }
+  }
+  return max();
+}
+
+std::size_t
+libbear::histogram::
+index(std::uint64_t v) {
+  // Values below sub_buckets have buckets of width 1, then every power of
+  // two 2^e has its own row of sub_buckets buckets of width 2^(e - precision).
+  if (v < sub_buckets) {
+    return v;
+  }
+  const unsigned e = std::bit_width(v) - 1;
+  const auto shift = e - precision;
+  return (shift + 1) * sub_buckets + ((v >> shift) - sub_buckets);
+}
+
+std::uint64_t
+libbear::histogram::
+highest(std::size_t i) {
+  if (i < sub_buckets) {
+    return i;
+  }
+  const auto shift = i / sub_buckets - 1;
+  const std::uint64_t lowest = (sub_buckets + i % sub_buckets) << shift;
+  return lowest + ((std::uint64_t{1} << shift) - 1);
+}
@@ -0,0 +1,56 @@
+#ifndef LIBBEAR_CORE_HISTOGRAM_H
+#define LIBBEAR_CORE_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace libbear {
+
+  // Histogram of nonnegative integer values (e.g. latencies in nanoseconds)
+  // in the spirit of HdrHistogram: every power of two is split into
+  // 2^precision buckets of equal width, so values are kept with relative
+  // error below 2^-precision over the whole 64-bit range in constant
+  // memory. Values can be recorded from many threads at once without locks.
+  class histogram {
+  public:
+    static constexpr unsigned precision{5};
+
+  private:
+    static constexpr std::size_t sub_buckets{std::size_t{1} << precision};
+    static constexpr std::size_t buckets{(65 - precision) * sub_buckets};
+
+  public:
+    histogram() = default;
+    histogram(const histogram&) = delete;
+    histogram& operator=(const histogram&) = delete;
+
+    void record(std::uint64_t v);
+
+    std::uint64_t count() const { return count_.load(); }
+    // Exact values; min() of empty histogram is the largest value.
+    std::uint64_t min() const { return min_.load(); }
+    std::uint64_t max() const { return max_.load(); }
+    double mean() const;
+    // Value not exceeded by given percent of recorded values, p from
+    // [0, 100], up to precision of buckets; 0 for empty histogram.
+    std::uint64_t percentile(double p) const;
+
+  private:
+    static std::size_t index(std::uint64_t v);
+    // The largest value of bucket.
+    static std::uint64_t highest(std::size_t i);
+
+  private:
+    std::array<std::atomic<std::uint64_t>, buckets> counts_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> min_{std::numeric_limits<std::uint64_t>::max()};
+    std::atomic<std::uint64_t> max_{0};
+  };
+
+} // namespace libbear
+
+#endif // LIBBEAR_CORE_HISTOGRAM_H
@@ -1,11 +1,155 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
 #include <random>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 #include <libbear/core/random.h>
 
-std::mt19937&
+namespace {
+
+  std::uint64_t nondeterministic_seed() {
+    std::random_device rd{};
+    return (std::uint64_t{rd()} << 32) | rd();
+  }
+
+  std::atomic_uint64_t master_seed{nondeterministic_seed()};
+  std::atomic_uint64_t seed_epoch{0};
+  std::atomic_uint64_t next_stream{1};
+  std::atomic_uint64_t next_thread{0};
+
+  // Stream 0 belongs to the main thread, streams with most significant bit
+  // set belong to other threads, the rest is given by reserve_random_streams.
+  const std::thread::id main_thread{std::this_thread::get_id()};
+  constexpr std::uint64_t thread_streams{std::uint64_t{1} << 63};
+
+  struct thread_engine {
+    const std::uint64_t stream{std::this_thread::get_id() == main_thread
+                               ? 0
+                               : thread_streams | next_thread++};
+    std::uint64_t epoch{~std::uint64_t{0}};
+    libbear::random_engine_type engine{};
+  };
+
+  thread_local thread_engine default_engine{};
+  thread_local libbear::random_engine_type* current_engine{nullptr};
+
+}
+
+void
+libbear::
+random_seed(std::uint64_t seed) {
+  master_seed = seed;
+  next_stream = 1;
+  ++seed_epoch;
+}
+
+std::uint64_t
+libbear::
+random_seed() {
+  return master_seed;
+}
+
+libbear::random_engine_type&
 libbear::
 random_engine()
 {
-  static std::mt19937 engine{ std::random_device{}() };
-  return engine;
+  if (current_engine) {
+    return *current_engine;
+  }
+  auto& x = default_engine;
+  if (const auto e = seed_epoch.load(); e != x.epoch) {
+    x.engine = random_engine_type{master_seed, x.stream};
+    x.epoch = e;
+  }
+  return x.engine;
+}
+
+std::uint64_t
+libbear::
+reserve_random_streams(std::size_t n) {
+  return next_stream.fetch_add(n);
 }
 
+libbear::random_stream::
+random_stream(std::uint64_t stream)
+  : engine_{random_seed(), stream}, previous_{current_engine} {
+  current_engine = &engine_;
+}
+
+libbear::random_stream::
+~random_stream() {
+  current_engine = previous_;
+}
+
+libbear::alias_table::
+alias_table(std::span<const double> weights)
+  : columns_(weights.size()) {
+  const std::size_t n = weights.size();
+  const double sum = std::accumulate(weights.begin(), weights.end(), 0.);
+  if (n == 0 || n > std::numeric_limits<std::uint32_t>::max()
+      || !(sum > 0.) || !std::isfinite(sum)) {
+    throw std::invalid_argument{"alias_table: bad weights"};
+  }
+  // Scaled probabilities; stacks of columns below and above average share
+  // one buffer, growing from its front and from its back.
+  std::vector<double> p(n);
+  std::vector<std::uint32_t> work(n);
+  std::size_t small{0};
+  std::size_t large{n};
+  for (std::size_t i = 0; i < n; ++i) {
+    if (weights[i] < 0.) {
+      throw std::invalid_argument{"alias_table: bad weights"};
+    }
+    p[i] = weights[i] * n / sum;
+    work[p[i] < 1. ? small++ : --large] = i;
+  }
+  constexpr double scale = 4294967296.; // 2^32
+  constexpr std::uint32_t one = std::numeric_limits<std::uint32_t>::max();
+  while (small != 0 && large != n) {
+    const auto i = work[--small];
+    const auto j = work[large];
+    columns_[i] = column{static_cast<std::uint32_t>(p[i] * scale), j};
+    p[j] = (p[j] + p[i]) - 1.;
+    if (p[j] < 1.) {
+      ++large;
+      work[small++] = j;
+    }
+  }
+  // What is left has probability 1 up to rounding errors. Column of zero
+  // weight must never be kept, even if rounding left it here.
+  const auto positive = static_cast<std::uint32_t>(
+    std::ranges::find_if(weights, [](double w) { return w > 0.; })
+    - weights.begin());
+  const auto rest = [&](std::size_t b, std::size_t e) {
+    for (std::size_t k = b; k != e; ++k) {
+      const auto i = work[k];
+      columns_[i] = weights[i] == 0. ? column{0, positive} : column{one, i};
+    }
+  };
+  rest(0, small);
+  rest(large, n);
+}
+
+std::vector<std::size_t>
+libbear::alias_table::
+operator()(std::size_t n) const {
+  std::vector<std::size_t> res(n);
+  fill(res);
+  return res;
+}
+
+void
+libbear::alias_table::
+fill(std::span<std::size_t> s) const {
+  auto& generator{ random_engine() };
+  for (auto& x : s) {
+    x = draw(generator);
+  }
+}
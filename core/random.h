@@ -1,17 +1,116 @@
 #ifndef LIBBEAR_CORE_RANDOM_H
 #define LIBBEAR_CORE_RANDOM_H
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <limits>
+#include <numbers>
 #include <random>
+#include <span>
 #include <type_traits>
+#include <vector>
 
 namespace libbear {
 
   using probability = double;
 
-  std::mt19937& random_engine();
+  // Counter-based Philox4x32-10 generator [Salmon et al., SC'11]. Upper half
+  // of the counter selects the stream, so independent streams can be derived
+  // from one seed without any state shared between threads.
+  class philox_engine {
+  public:
+    using result_type = std::uint32_t;
+
+    static constexpr result_type min() { return 0; }
+
+    static constexpr result_type max()
+    { return std::numeric_limits<result_type>::max(); }
+
+    explicit philox_engine(std::uint64_t seed = 0, std::uint64_t stream = 0)
+      : key_{static_cast<std::uint32_t>(seed),
+             static_cast<std::uint32_t>(seed >> 32)}
+      , counter_{0, 0,
+                 static_cast<std::uint32_t>(stream),
+                 static_cast<std::uint32_t>(stream >> 32)}
+    {}
+
+    result_type operator()() {
+      if (i_ == block_.size()) {
+        generate();
+      }
+      return block_[i_++];
+    }
+
+    void discard(unsigned long long n) {
+      for (; n != 0; --n) {
+        operator()();
+      }
+    }
+
+    bool operator==(const philox_engine&) const = default;
+
+  private:
+    void generate() {
+      constexpr std::uint64_t m0{0xD2511F53};
+      constexpr std::uint64_t m1{0xCD9E8D57};
+      auto c = counter_;
+      auto k = key_;
+      for (int r = 0; r < 10; ++r) {
+        const std::uint64_t p0 = m0 * c[0];
+        const std::uint64_t p1 = m1 * c[2];
+        c = {static_cast<std::uint32_t>(p1 >> 32) ^ c[1] ^ k[0],
+             static_cast<std::uint32_t>(p1),
+             static_cast<std::uint32_t>(p0 >> 32) ^ c[3] ^ k[1],
+             static_cast<std::uint32_t>(p0)};
+        k[0] += 0x9E3779B9;
+        k[1] += 0xBB67AE85;
+      }
+      block_ = c;
+      i_ = 0;
+      if (++counter_[0] == 0) {
+        ++counter_[1];
+      }
+    }
+
+  private:
+    std::array<std::uint32_t, 2> key_;
+    std::array<std::uint32_t, 4> counter_;
+    std::array<std::uint32_t, 4> block_{};
+    std::size_t i_{block_.size()};
+  };
+
+  using random_engine_type = philox_engine;
+
+  // Master seed of all the streams. Fixed seed gives reproducible results
+  // regardless of the number of threads, provided that parallel tasks draw
+  // their numbers from streams obtained with reserve_random_streams().
+  void random_seed(std::uint64_t seed);
+  std::uint64_t random_seed();
+
+  // Engine of the calling thread (or of the random_stream active on it).
+  random_engine_type& random_engine();
+
+  // Returns the first of n consecutive, previously unused stream numbers.
+  std::uint64_t reserve_random_streams(std::size_t n);
+
+  // While in scope, random_engine() on the current thread draws from given
+  // stream of the master seed.
+  class random_stream {
+  public:
+    explicit random_stream(std::uint64_t stream);
+    random_stream(const random_stream&) = delete;
+    random_stream& operator=(const random_stream&) = delete;
+    ~random_stream();
+
+  private:
+    random_engine_type engine_;
+    random_engine_type* previous_;
+  };
 
   inline bool success(probability success_probability)
   { return std::bernoulli_distribution{ success_probability }(random_engine()); }
@@ -44,6 +143,102 @@ namespace libbear {
     }
   }
   
+  namespace detail {
+
+    // Uniform variate from [0, 1) built directly from engine output with full
+    // mantissa precision.
+    template<std::floating_point T>
+    T canonical(random_engine_type& e) {
+      constexpr int digits = std::numeric_limits<T>::digits;
+      static_assert(digits <= 64);
+      constexpr T scale =
+        T{.5} / static_cast<T>(std::uint64_t{1} << (digits - 1)); // 2^-digits
+      if constexpr (digits <= 32) {
+        return static_cast<T>(e() >> (32 - digits)) * scale;
+      } else {
+        const std::uint64_t x = (std::uint64_t{e()} << 32) | e();
+        return static_cast<T>(x >> (64 - digits)) * scale;
+      }
+    }
+
+  } // namespace detail
+
+  // Bulk versions of the above. Engine output is consumed in one pass and
+  // transformed in separate branch-free loops over contiguous memory, which
+  // compiler is able to vectorize.
+  template<std::floating_point T>
+  void fill_from_uniform_distribution(std::span<T> s, T a, T b)
+  {
+    assert(a < b);
+    auto& generator{ random_engine() };
+    for (auto& x : s) {
+      x = detail::canonical<T>(generator);
+    }
+    // Unlike a + u * (b - a), this form does not overflow for finite a and b.
+    const T top = std::nextafter(b, a);
+    for (auto& x : s) {
+      x = std::min((1 - x) * a + x * b, top); // [a, b)
+    }
+  }
+
+  template<std::floating_point T>
+  void fill_from_normal_distribution(std::span<T> s,
+                                     T mean,
+                                     T standard_deviation)
+  {
+    // Box-Muller transform of pairs of uniform variates.
+    const std::size_t n = s.size() / 2;
+    auto& generator{ random_engine() };
+    for (std::size_t i = 0; i < 2 * n; ++i) {
+      s[i] = detail::canonical<T>(generator);
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      const T r = std::sqrt(-2 * std::log(1 - s[2 * i]));
+      const T phi = 2 * std::numbers::pi_v<T> * s[2 * i + 1];
+      s[2 * i] = mean + standard_deviation * r * std::cos(phi);
+      s[2 * i + 1] = mean + standard_deviation * r * std::sin(phi);
+    }
+    if (s.size() % 2) {
+      s.back() = random_from_normal_distribution<T>(mean, standard_deviation);
+    }
+  }
+
+  // Sampler of discrete distribution given by nonnegative weights: Walker's
+  // alias method in numerically stable variant of M. D. Vose [IEEE Trans.
+  // Softw. Eng. 17 (1991) 972]. Table is built in O(n), every draw costs
+  // O(1): two engine outputs and one comparison.
+  class alias_table {
+  public:
+    explicit alias_table(std::span<const double> weights);
+
+    std::size_t size() const { return columns_.size(); }
+    std::size_t operator()() const { return draw(random_engine()); }
+
+    // Batch of n indices.
+    std::vector<std::size_t> operator()(std::size_t n) const;
+    void fill(std::span<std::size_t> s) const;
+
+  private:
+    // Column is kept with probability threshold / 2^32, otherwise its alias
+    // is drawn. Both fields share cache line.
+    struct column {
+      std::uint32_t threshold;
+      std::uint32_t alias;
+    };
+
+    std::size_t draw(random_engine_type& e) const {
+      // Multiply-shift maps 32 random bits onto [0, n) [D. Lemire, ACM Trans.
+      // Model. Comput. Simul. 29 (2019) 3]; bias of order n / 2^32 is
+      // negligible here.
+      const std::size_t i = (std::uint64_t{e()} * size()) >> 32;
+      const column c = columns_[i];
+      return e() < c.threshold ? i : std::size_t{c.alias};
+    }
+
+  private:
+    std::vector<column> columns_{};
+  };
+
   template<typename>
   class range;
   
@@ -1,23 +1,781 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
 #include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
 #include <tuple>
-#include <boost/asio/io_context.hpp>
-#include <boost/process/async.hpp>
-#include <boost/process/child.hpp>
-#include <boost/process/io.hpp>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <libbear/core/system.h>
 
-std::tuple<std::string, std::string>
-libbear::execute(const std::string& command) {
-  boost::asio::io_context ioc{};
-  std::future<std::string> out{};
-  std::future<std::string> err{};
-  boost::process::child c{command.c_str(),
-    boost::process::std_in.close(),
-    boost::process::std_out > out,
-    boost::process::std_err > err,
-    ioc};
-  ioc.run();
-  return std::tuple<std::string, std::string>{out.get(), err.get()};
+extern char** environ;
+
+namespace {
+
+  [[noreturn]] void fail(const std::string& what, int error = errno) {
+    throw std::system_error{error, std::generic_category(),
+                            "execute: " + what};
+  }
+
+  using clock = std::chrono::steady_clock;
+
+  libbear::execution_failed failure(int status, libbear::execution_result r) {
+    if (WIFSIGNALED(status)) {
+      const int s = WTERMSIG(status);
+      return libbear::execution_failed{
+        "execute: killed by signal " + std::to_string(s), 128 + s, std::move(r)
+      };
+    }
+    const int s = WEXITSTATUS(status);
+    return libbear::execution_failed{
+      "execute: exit status " + std::to_string(s), s, std::move(r)
+    };
+  }
+
+  // Glibc implements posix_spawn with vfork-like clone, so memory of the
+  // parent is not copied. Resource limits are set by the shell before
+  // command is run.
+  pid_t spawn(const std::string& command,
+              posix_spawn_file_actions_t& fa,
+              const libbear::execution_options& o = {},
+              bool group = false) {
+    std::string limits{};
+    if (o.cpu_time.count() != 0) {
+      limits += "ulimit -t " + std::to_string(o.cpu_time.count())
+        + " || exit 126; ";
+    }
+    if (o.memory != 0) {
+      limits += "ulimit -v " + std::to_string((o.memory + 1023) / 1024)
+        + " || exit 126; ";
+    }
+    const std::string script{limits + "eval \"$1\""};
+    std::vector<const char*> argv{"sh", "-c"};
+    if (limits.empty()) {
+      argv.insert(argv.end(), {command.c_str(), nullptr});
+    } else {
+      argv.insert(argv.end(), {script.c_str(), "sh", command.c_str(), nullptr});
+    }
+    posix_spawnattr_t attr;
+    ::posix_spawnattr_init(&attr);
+    if (group) {
+      ::posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+      ::posix_spawnattr_setpgroup(&attr, 0);
+    }
+    pid_t res{};
+    const int e = ::posix_spawn(&res, "/bin/sh", &fa, &attr,
+                                const_cast<char* const*>(argv.data()),
+                                environ);
+    ::posix_spawnattr_destroy(&attr);
+    ::posix_spawn_file_actions_destroy(&fa);
+    if (e != 0) {
+      fail("posix_spawn", e);
+    }
+    return res;
+  }
+
+  // Running command and its outputs collected so far. Closed descriptors
+  // are set to -1.
+  struct child {
+    pid_t pid{};
+    int out{-1};
+    int err{-1};
+    // Becomes readable when process exits; -1 on kernels without pidfd.
+    int pidfd{-1};
+    bool exited{false};
+    // Wait status, if exited.
+    int status{0};
+    // Which wait statuses are reported as execution_failed.
+    bool check_status{false};
+    bool limited{false};
+    clock::time_point deadline{clock::time_point::max()};
+    // Set from stop callback, possibly on other thread.
+    std::atomic_bool cancelled{false};
+    // Reason of killing the process group.
+    std::exception_ptr interrupted{};
+    std::string out_data{};
+    std::string err_data{};
+    std::promise<libbear::execution_result> result{};
+    // Callbacks of stop tokens of options and of thread limits.
+    std::optional<std::stop_callback<std::function<void()>>> on_stop{};
+    std::optional<std::stop_callback<std::function<void()>>> on_thread_stop{};
+    // Filled in when process is reaped, if given.
+    libbear::execution_usage* usage{nullptr};
+  };
+
+  // Shell running command reports its death by signal as status 128 + signal.
+  bool failed(const child& c) {
+    const int s = c.status;
+    if (c.check_status) {
+      return !WIFEXITED(s) || WEXITSTATUS(s) != 0;
+    }
+    return c.limited && (WIFSIGNALED(s) || WEXITSTATUS(s) > 128);
+  }
+
+  thread_local libbear::execution_usage thread_usage{};
+  thread_local libbear::execution_limits thread_limits{};
+
+  // Reaps the process, if it has exited. Reactor thread never blocks here.
+  void reap(child& c) {
+    rusage ru{};
+    const pid_t r = ::wait4(c.pid, &c.status, WNOHANG, &ru);
+    if (r == 0 || (r < 0 && errno == EINTR)) {
+      return;
+    }
+    if (r == c.pid && c.usage) {
+      using std::chrono::microseconds;
+      using std::chrono::seconds;
+      c.usage->commands = 1;
+      c.usage->cpu_time =
+        seconds{ru.ru_utime.tv_sec} + microseconds{ru.ru_utime.tv_usec}
+        + seconds{ru.ru_stime.tv_sec} + microseconds{ru.ru_stime.tv_usec};
+      c.usage->peak_rss = static_cast<std::size_t>(ru.ru_maxrss) * 1024;
+    }
+    c.exited = true;
+  }
+
+  // Single thread waiting with epoll for outputs and exits of all children
+  // and for their deadlines.
+  class reactor {
+  public:
+    static reactor& instance() {
+      static reactor r{};
+      return r;
+    }
+
+    std::future<libbear::execution_result>
+    launch(const std::string& command,
+           const libbear::execution_options& o,
+           libbear::execution_usage* usage = nullptr);
+
+  private:
+    reactor();
+    reactor(const reactor&) = delete;
+    reactor& operator=(const reactor&) = delete;
+    ~reactor();
+
+    void run();
+    void wake();
+    void watch(int fd, const std::shared_ptr<child>& c);
+    void unwatch(int& fd);
+    void handle(int fd);
+    bool read_output(int fd, child& c);
+    int interrupt();
+    void finish(const std::shared_ptr<child>& c);
+
+  private:
+    // Period of checking children in unreaped_.
+    static constexpr std::chrono::milliseconds reap_period{10};
+
+    std::mutex m_{};
+    // Children by their watched descriptors.
+    std::unordered_map<int, std::shared_ptr<child>> children_{};
+    // Children without pidfd which have closed their outputs or were killed,
+    // but have not exited yet.
+    std::vector<std::shared_ptr<child>> unreaped_{};
+    const int epoll_;
+    // Written to make the thread check deadlines, cancellations and
+    // stopping_.
+    const int wakeup_;
+    bool stopping_{false};
+    std::thread thread_{};
+  };
+
+  reactor::
+  reactor()
+    : epoll_{::epoll_create1(EPOLL_CLOEXEC)}
+    , wakeup_{::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)} {
+    if (epoll_ < 0 || wakeup_ < 0) {
+      fail("reactor");
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeup_;
+    if (::epoll_ctl(epoll_, EPOLL_CTL_ADD, wakeup_, &ev) != 0) {
+      fail("epoll_ctl");
+    }
+    thread_ = std::thread{&reactor::run, this};
+  }
+
+  reactor::
+  ~reactor() {
+    {
+      std::lock_guard<std::mutex> lg{m_};
+      stopping_ = true;
+    }
+    wake();
+    thread_.join();
+    for (const auto& [fd, c] : children_) {
+      ::close(fd);
+    }
+    ::close(wakeup_);
+    ::close(epoll_);
+  }
+
+  std::future<libbear::execution_result>
+  reactor::
+  launch(const std::string& command,
+         const libbear::execution_options& o,
+         libbear::execution_usage* usage) {
+    int out[2];
+    int err[2];
+    if (::pipe2(out, O_CLOEXEC) != 0) {
+      fail("pipe");
+    }
+    if (::pipe2(err, O_CLOEXEC) != 0) {
+      const int e = errno;
+      ::close(out[0]);
+      ::close(out[1]);
+      fail("pipe", e);
+    }
+    posix_spawn_file_actions_t fa;
+    ::posix_spawn_file_actions_init(&fa);
+    ::posix_spawn_file_actions_addopen(&fa, 0, "/dev/null", O_RDONLY, 0);
+    ::posix_spawn_file_actions_adddup2(&fa, out[1], 1);
+    ::posix_spawn_file_actions_adddup2(&fa, err[1], 2);
+    const auto c = std::make_shared<child>();
+    c->usage = usage;
+    c->check_status = o.check_status;
+    c->limited = o.cpu_time.count() != 0 || o.memory != 0;
+    c->deadline = std::min(o.timeout.count() > 0 ? clock::now() + o.timeout
+                                                 : clock::time_point::max(),
+                           thread_limits.deadline);
+    // Own process group is created only if it might have to be killed, so
+    // that otherwise terminal signals reach the command too.
+    const bool interruptible = c->deadline != clock::time_point::max()
+      || o.stop.stop_possible() || thread_limits.stop.stop_possible();
+    try {
+      c->pid = spawn(command, fa, o, interruptible);
+    } catch (...) {
+      for (const int fd : {out[0], out[1], err[0], err[1]}) {
+        ::close(fd);
+      }
+      throw;
+    }
+    ::close(out[1]);
+    ::close(err[1]);
+    ::fcntl(out[0], F_SETFL, O_NONBLOCK);
+    ::fcntl(err[0], F_SETFL, O_NONBLOCK);
+    c->out = out[0];
+    c->err = err[0];
+    c->pidfd = static_cast<int>(::syscall(SYS_pidfd_open, c->pid, 0));
+    auto res = c->result.get_future();
+    {
+      std::lock_guard<std::mutex> lg{m_};
+      watch(c->out, c);
+      watch(c->err, c);
+      if (c->pidfd >= 0) {
+        watch(c->pidfd, c);
+      }
+    }
+    if (c->deadline != clock::time_point::max()) {
+      wake();
+    }
+    // Callbacks do not lock m_, so they cannot deadlock with destruction of
+    // child, which waits for callback running on other thread.
+    const auto cancel = [this, p = c.get()]() {
+      p->cancelled = true;
+      wake();
+    };
+    if (o.stop.stop_possible()) {
+      c->on_stop.emplace(o.stop, cancel);
+    }
+    if (thread_limits.stop.stop_possible()) {
+      c->on_thread_stop.emplace(thread_limits.stop, cancel);
+    }
+    return res;
+  }
+
+  void
+  reactor::
+  wake() {
+    const std::uint64_t one{1};
+    [[maybe_unused]] const auto n = ::write(wakeup_, &one, sizeof one);
+  }
+
+  void
+  reactor::
+  watch(int fd, const std::shared_ptr<child>& c) {
+    children_.emplace(fd, c);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (::epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      fail("epoll_ctl");
+    }
+  }
+
+  void
+  reactor::
+  unwatch(int& fd) {
+    if (fd >= 0) {
+      children_.erase(fd);
+      ::close(fd);
+      fd = -1;
+    }
+  }
+
+  void
+  reactor::
+  run() {
+    epoll_event events[64];
+    int timeout{-1};
+    for (;;) {
+      const int n = ::epoll_wait(epoll_, events, std::size(events), timeout);
+      if (n < 0 && errno != EINTR) {
+        return;
+      }
+      std::lock_guard<std::mutex> lg{m_};
+      for (int i = 0; i < n; ++i) {
+        if (events[i].data.fd != wakeup_) {
+          handle(events[i].data.fd);
+          continue;
+        }
+        std::uint64_t x{};
+        [[maybe_unused]] const auto r = ::read(wakeup_, &x, sizeof x);
+        if (stopping_) {
+          return;
+        }
+      }
+      timeout = interrupt();
+    }
+  }
+
+  void
+  reactor::
+  handle(int fd) {
+    const auto it = children_.find(fd);
+    if (it == children_.end()) {
+      return;
+    }
+    const auto c = it->second;
+    if (fd == c->pidfd) {
+      reap(*c);
+      unwatch(c->pidfd);
+    } else if (!read_output(fd, *c)) {
+      return;
+    } else {
+      unwatch(fd == c->out ? c->out : c->err);
+    }
+    if (c->out < 0 && c->err < 0 && !c->exited && c->pidfd < 0) {
+      // Without pidfd process is reaped when it closes its outputs, or
+      // later, if it is still running.
+      reap(*c);
+      if (!c->exited) {
+        unreaped_.push_back(c);
+      }
+    }
+    // Outputs of killed command might be kept open by its descendants which
+    // left the process group.
+    if (c->exited && (c->interrupted || (c->out < 0 && c->err < 0))) {
+      finish(c);
+    }
+  }
+
+  // Returns true if output is closed.
+  bool
+  reactor::
+  read_output(int fd, child& c) {
+    char buf[65536];
+    for (;;) {
+      const auto n = ::read(fd, buf, sizeof buf);
+      if (n > 0) {
+        (fd == c.out ? c.out_data : c.err_data).append(buf, n);
+      } else if (n < 0 && errno == EINTR) {
+        continue;
+      } else {
+        // Nothing more to read now, end of file or error.
+        return !(n < 0 && errno == EAGAIN);
+      }
+    }
+  }
+
+  // Kills process groups of cancelled children and of children after their
+  // deadlines. Returns time to the nearest deadline in milliseconds, -1 if
+  // there is none.
+  int
+  reactor::
+  interrupt() {
+    const auto now = clock::now();
+    auto next = clock::time_point::max();
+    std::vector<std::shared_ptr<child>> killed{};
+    const auto check = [&](const std::shared_ptr<child>& c) {
+      if (c->interrupted) {
+        return;
+      }
+      if (c->cancelled || now >= c->deadline) {
+        c->interrupted = c->cancelled
+          ? std::make_exception_ptr(libbear::execution_cancelled{})
+          : std::make_exception_ptr(libbear::execution_timeout{});
+        ::kill(-c->pid, SIGKILL);
+        killed.push_back(c);
+      } else {
+        next = std::min(next, c->deadline);
+      }
+    };
+    for (const auto& [fd, c] : children_) {
+      check(c);
+    }
+    for (const auto& c : unreaped_) {
+      check(c);
+    }
+    for (const auto& c : killed) {
+      if (!c->exited && c->pidfd < 0) {
+        reap(*c);
+        if (!c->exited && std::ranges::find(unreaped_, c) == unreaped_.end()) {
+          unreaped_.push_back(c);
+        }
+      }
+      if (c->exited) {
+        finish(c);
+      }
+    }
+    // Children which have exited are finished here or have been finished
+    // above.
+    std::erase_if(unreaped_, [&](const std::shared_ptr<child>& c) {
+      if (!c->exited) {
+        reap(*c);
+        if (!c->exited) {
+          next = std::min(next, now + reap_period);
+          return false;
+        }
+        finish(c);
+      }
+      return true;
+    });
+    if (next == clock::time_point::max()) {
+      return -1;
+    }
+    using std::chrono::ceil;
+    using std::chrono::milliseconds;
+    return static_cast<int>(ceil<milliseconds>(next - now).count());
+  }
+
+  void
+  reactor::
+  finish(const std::shared_ptr<child>& c) {
+    unwatch(c->out);
+    unwatch(c->err);
+    unwatch(c->pidfd);
+    libbear::execution_result r{std::move(c->out_data),
+                                std::move(c->err_data)};
+    if (c->interrupted) {
+      c->result.set_exception(std::exchange(c->interrupted, nullptr));
+    } else if (failed(*c)) {
+      c->result.set_exception(
+        std::make_exception_ptr(failure(c->status, std::move(r))));
+    } else {
+      c->result.set_value(std::move(r));
+    }
+  }
+
+  // Deadline and stop tokens (of options and of thread limits) of request
+  // to evaluator.
+  struct request_limits {
+    clock::time_point deadline;
+    std::stop_token stop;
+    std::stop_token thread_stop;
+
+    bool stop_requested() const
+    { return stop.stop_requested() || thread_stop.stop_requested(); }
+
+    bool stop_possible() const
+    { return stop.stop_possible() || thread_stop.stop_possible(); }
+  };
+
+  // Waits until fd is ready for events. Stop request is checked at least
+  // every 50 ms, if it is possible.
+  void await(int fd, short events, const request_limits& l) {
+    using std::chrono::ceil;
+    using std::chrono::milliseconds;
+    for (;;) {
+      if (l.stop_requested()) {
+        throw libbear::execution_cancelled{};
+      }
+      const auto now = clock::now();
+      if (now >= l.deadline) {
+        throw libbear::execution_timeout{};
+      }
+      long long timeout = l.deadline == clock::time_point::max()
+        ? -1 : std::min<long long>(ceil<milliseconds>(l.deadline - now).count(),
+                                   INT_MAX);
+      if (l.stop_possible()) {
+        timeout = timeout < 0 ? 50 : std::min(timeout, 50LL);
+      }
+      pollfd p{fd, events, 0};
+      const int n = ::poll(&p, 1, static_cast<int>(timeout));
+      if (n > 0) {
+        return;
+      }
+      if (n < 0 && errno != EINTR) {
+        fail("poll");
+      }
+    }
+  }
+
+  void send_all(int fd, std::string_view s, const request_limits& l) {
+    while (!s.empty()) {
+      await(fd, POLLOUT, l);
+      const auto n = ::send(fd, s.data(), s.size(),
+                            MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+        continue;
+      }
+      if (n < 0) {
+        throw std::runtime_error{"evaluator_pool: cannot send request"};
+      }
+      s.remove_prefix(n);
+    }
+  }
+
+  // Reads from fd to buffer until it is longer than sz.
+  void receive(int fd, std::string& buffer, std::size_t sz,
+               const request_limits& l) {
+    char buf[65536];
+    while (buffer.size() <= sz) {
+      await(fd, POLLIN, l);
+      const auto n = ::recv(fd, buf, sizeof buf, MSG_DONTWAIT);
+      if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+        continue;
+      }
+      if (n <= 0) {
+        throw std::runtime_error{"evaluator_pool: no response"};
+      }
+      buffer.append(buf, n);
+    }
+  }
+
+  // Returns true if process group of pid, its leader, is empty before
+  // deadline. Leader is reaped, if it exits.
+  bool reap_group_until(pid_t pid, clock::time_point deadline) {
+    for (bool reaped{false};;) {
+      if (!reaped) {
+        const pid_t r = ::waitpid(pid, nullptr, WNOHANG);
+        reaped = r == pid || (r < 0 && errno != EINTR);
+      }
+      if (reaped && ::kill(-pid, 0) != 0) {
+        return true;
+      }
+      if (clock::now() >= deadline) {
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    }
+  }
+
+}
+
+std::future<libbear::execution_result>
+libbear::execute_async(const std::string& command,
+                       const execution_options& o) {
+  return reactor::instance().launch(command, o);
+}
+
+libbear::execution_usage&
+libbear::execution_usage::
+operator+=(const execution_usage& u) {
+  commands += u.commands;
+  cpu_time += u.cpu_time;
+  peak_rss = std::max(peak_rss, u.peak_rss);
+  return *this;
+}
+
+libbear::execution_usage&
+libbear::thread_execution_usage() {
+  return thread_usage;
+}
+
+libbear::execution_limits&
+libbear::thread_execution_limits() {
+  return thread_limits;
 }
 
+libbear::execution_result
+libbear::execute(const std::string& command, const execution_options& o) {
+  // Usage is written before the result is made ready.
+  execution_usage u{};
+  auto f = reactor::instance().launch(command, o, &u);
+  f.wait();
+  thread_usage += u;
+  return f.get();
+}
+
+libbear::evaluator_pool::
+evaluator_pool(const std::string& command,
+               std::size_t sz,
+               const execution_options& o)
+  : command_{command}, options_{o}, evaluators_(sz) {
+  if (sz == 0) {
+    throw std::invalid_argument{"evaluator_pool: bad size"};
+  }
+  try {
+    for (auto& e : evaluators_) {
+      start(e);
+    }
+  } catch (...) {
+    for (auto& e : evaluators_) {
+      stop(e);
+    }
+    throw;
+  }
+  for (std::size_t i = 0; i < sz; ++i) {
+    idle_.push_back(i);
+  }
+}
+
+libbear::evaluator_pool::
+~evaluator_pool() {
+  // End of input asks evaluators to exit.
+  for (auto& e : evaluators_) {
+    if (e.fd >= 0) {
+      ::close(e.fd);
+      e.fd = -1;
+    }
+  }
+  for (const int signal : {SIGTERM, SIGKILL}) {
+    const auto deadline = clock::now() + grace;
+    for (auto& e : evaluators_) {
+      if (e.pid >= 0 && reap_group_until(e.pid, deadline)) {
+        e.pid = -1;
+      }
+    }
+    for (const auto& e : evaluators_) {
+      if (e.pid >= 0) {
+        ::kill(-e.pid, signal);
+      }
+    }
+  }
+  for (const auto& e : evaluators_) {
+    if (e.pid >= 0) {
+      ::waitpid(e.pid, nullptr, 0);
+    }
+  }
+}
+
+std::string
+libbear::evaluator_pool::
+operator()(const std::string& request) {
+  std::size_t i{};
+  {
+    std::unique_lock<std::mutex> ul{m_};
+    cv_.wait(ul, [this]() { return !idle_.empty(); });
+    i = idle_.back();
+    idle_.pop_back();
+  }
+  const auto release = [this, i]() {
+    {
+      std::lock_guard<std::mutex> lg{m_};
+      idle_.push_back(i);
+    }
+    cv_.notify_one();
+  };
+  auto& e = evaluators_[i];
+  try {
+    if (e.fd < 0) {
+      start(e);
+    }
+    auto res = exchange(e, request);
+    release();
+    return res;
+  } catch (...) {
+    stop(e);
+    release();
+    throw;
+  }
+}
+
+void
+libbear::evaluator_pool::
+start(evaluator& e) const {
+  int sv[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) {
+    fail("socketpair");
+  }
+  posix_spawn_file_actions_t fa;
+  ::posix_spawn_file_actions_init(&fa);
+  ::posix_spawn_file_actions_adddup2(&fa, sv[1], 0);
+  ::posix_spawn_file_actions_adddup2(&fa, sv[1], 1);
+  try {
+    e.pid = spawn(command_, fa, options_, true);
+  } catch (...) {
+    ::close(sv[0]);
+    ::close(sv[1]);
+    throw;
+  }
+  ::close(sv[1]);
+  e.fd = sv[0];
+  e.buffer.clear();
+}
+
+// Kills evaluator, which is broken or interrupted.
+void
+libbear::evaluator_pool::
+stop(evaluator& e) {
+  if (e.fd < 0) {
+    return;
+  }
+  ::close(e.fd);
+  ::kill(-e.pid, SIGKILL);
+  ::waitpid(e.pid, nullptr, 0);
+  e.fd = -1;
+  e.pid = -1;
+}
+
+std::string
+libbear::evaluator_pool::
+exchange(evaluator& e, const std::string& request) const {
+  const request_limits l{
+    std::min(options_.timeout.count() > 0 ? clock::now() + options_.timeout
+                                          : clock::time_point::max(),
+             thread_limits.deadline),
+    options_.stop,
+    thread_limits.stop
+  };
+  send_all(e.fd, std::to_string(request.size()) + '\n' + request, l);
+  // Length of frame has at most 20 digits.
+  std::size_t eol{};
+  while ((eol = e.buffer.find('\n')) == std::string::npos
+         && e.buffer.size() <= 20) {
+    receive(e.fd, e.buffer, e.buffer.size(), l);
+  }
+  if (eol == std::string::npos || eol == 0) {
+    throw std::runtime_error{"evaluator_pool: bad response"};
+  }
+  std::size_t sz{};
+  const char* const end = e.buffer.data() + eol;
+  if (const auto [p, ec] = std::from_chars(e.buffer.data(), end, sz);
+      ec != std::errc{} || p != end) {
+    throw std::runtime_error{"evaluator_pool: bad response"};
+  }
+  receive(e.fd, e.buffer, eol + sz, l);
+  std::string res = e.buffer.substr(eol + 1, sz);
+  e.buffer.erase(0, eol + 1 + sz);
+  return res;
+}
@@ -1,14 +1,169 @@
 #ifndef LIBBEAR_CORE_SYSTEM_H
 #define LIBBEAR_CORE_SYSTEM_H
 
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <stop_token>
 #include <string>
 #include <tuple>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
 
 namespace libbear {
 
-  std::tuple<std::string, std::string> execute(const std::string& command);
+  // Standard output and standard error of command.
+  using execution_result = std::tuple<std::string, std::string>;
+
+  // Zero values mean no limit.
+  struct execution_options {
+    // Wall-clock time from the start of command.
+    std::chrono::milliseconds timeout{0};
+    // Resource limits (RLIMIT_CPU, RLIMIT_AS) of every process of command.
+    std::chrono::seconds cpu_time{0};
+    std::size_t memory{0}; // bytes
+    // Stop request cancels command.
+    std::stop_token stop{};
+    // Nonzero exit status of command is an error.
+    bool check_status{false};
+  };
+
+  // Command killed because of timeout or cancellation.
+  class execution_interrupted : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  class execution_timeout : public execution_interrupted {
+  public:
+    execution_timeout() : execution_interrupted{"execute: timeout"} {}
+  };
+
+  class execution_cancelled : public execution_interrupted {
+  public:
+    execution_cancelled() : execution_interrupted{"execute: cancelled"} {}
+  };
+
+  // Command killed by signal while its resource limits were set, or which
+  // exited with nonzero status when execution_options::check_status is set.
+  class execution_failed : public std::runtime_error {
+  public:
+    execution_failed(const std::string& what, int status, execution_result r)
+      : std::runtime_error{what}, status_{status}, result_{std::move(r)}
+    {}
+
+    // Exit status, or 128 + number of signal as in shell.
+    int status() const { return status_; }
+    // Outputs collected until the end.
+    const execution_result& result() const { return result_; }
+
+  private:
+    int status_;
+    execution_result result_;
+  };
+
+  // Limits of all commands run on calling thread (by execute(),
+  // execute_async() or evaluator_pool), in addition to their own options:
+  // the earlier deadline applies and either stop request interrupts command.
+  struct execution_limits {
+    std::chrono::steady_clock::time_point deadline{
+      std::chrono::steady_clock::time_point::max()
+    };
+    std::stop_token stop{};
+  };
+
+  execution_limits& thread_execution_limits();
+
+  // Resources used by commands.
+  struct execution_usage {
+    std::size_t commands{0};
+    // User and system time of command, with its waited for descendants.
+    std::chrono::nanoseconds cpu_time{0};
+    // Maximum resident set size of the largest process, in bytes.
+    std::size_t peak_rss{0};
+
+    execution_usage& operator+=(const execution_usage& u);
+  };
+
+  // Sum of resources used by commands run with execute() on calling thread.
+  execution_usage& thread_execution_usage();
+
+  // Command is run by /bin/sh -c in its own process group with standard
+  // input redirected from /dev/null. Result is ready when the command has
+  // exited and both of its outputs are closed. Outputs, exits and deadlines
+  // of all running commands are watched by one shared thread, so no thread
+  // is blocked while waiting for them. Interrupted command has its whole
+  // process group killed and its result is execution_timeout or
+  // execution_cancelled exception. Command killed after exceeding its
+  // resource limit has execution_failed as result (see execution_failed).
+  std::future<execution_result>
+  execute_async(const std::string& command,
+                const execution_options& o = execution_options{});
+
+  execution_result execute(const std::string& command,
+                           const execution_options& o = execution_options{});
+
+  // Pool of long-lived evaluator processes, each started with command (run
+  // by /bin/sh -c), so that the cost of startup and of warming up is paid
+  // once instead of for every request. Request is written to standard input
+  // of idle evaluator and response is read from its standard output, both
+  // of them are connected to Unix socket. Standard error is inherited.
+  // Every message is a frame: its length in bytes as decimal number ended
+  // with newline, followed by the message itself. Evaluator should answer
+  // requests one by one and exit at the end of its input.
+  // Requests can be made from many threads at once; if all evaluators are
+  // busy, caller waits. Evaluators run in their own process groups, which
+  // are signalled when they are stopped.
+  class evaluator_pool {
+  private:
+    // Closed socket (-1) means that evaluator has to be (re)started.
+    struct evaluator {
+      pid_t pid{-1};
+      int fd{-1};
+      std::string buffer{};
+    };
+
+  public:
+    // Evaluators still running after grace time from the end of their input
+    // (on destruction of pool) are sent SIGTERM, and SIGKILL after another
+    // grace time.
+    static constexpr std::chrono::milliseconds grace{1000};
+
+    // Options apply to every evaluator: timeout to every request, from
+    // sending it until the whole response is read, resource limits to the
+    // evaluator process during its whole life, and stop request interrupts
+    // requests.
+    evaluator_pool(const std::string& command,
+                   std::size_t sz,
+                   const execution_options& o = execution_options{});
+    evaluator_pool(const evaluator_pool&) = delete;
+    evaluator_pool& operator=(const evaluator_pool&) = delete;
+    ~evaluator_pool();
+
+    std::size_t size() const { return evaluators_.size(); }
+    // Evaluator which dies, breaks the protocol or is interrupted is killed
+    // and restarted before the next request. Then std::runtime_error, or
+    // execution_timeout or execution_cancelled, respectively, is thrown.
+    std::string operator()(const std::string& request);
+
+  private:
+    void start(evaluator& e) const;
+    static void stop(evaluator& e);
+    std::string exchange(evaluator& e, const std::string& request) const;
+
+  private:
+    const std::string command_;
+    const execution_options options_;
+    std::vector<evaluator> evaluators_;
+    std::mutex m_{};
+    std::condition_variable cv_{};
+    std::vector<std::size_t> idle_{};
+  };
 
 } // namespace libbear
 
 #endif // LIBBEAR_CORE_SYSTEM_H
-
@@ -1,19 +1,143 @@
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
 #include <libbear/core/thread.h>
 
-void
+namespace {
+
+  // Identification of the worker running on current thread.
+  thread_local const libbear::thread_pool* current_pool{nullptr};
+  thread_local std::size_t current_worker{0};
+
+}
+
 libbear::thread_pool::
-acquire() {
-  std::unique_lock<std::mutex> ul{m_};
-  cv_.wait(ul, [this]() { return free_threads_ != 0; });
-  --free_threads_;
+thread_pool(std::size_t sz) {
+  if (sz == 0) {
+    throw std::invalid_argument{"thread_pool: no threads"};
+  }
+  for (std::size_t i = 0; i < sz; ++i) {
+    queues_.push_back(std::make_unique<task_queue>());
+  }
+  for (std::size_t i = 0; i < sz; ++i) {
+    workers_.emplace_back([this, i]() { work(i); });
+  }
+}
+
+unsigned int
+libbear::thread_pool::shared_sz =
+  std::max(std::thread::hardware_concurrency(), 1u);
+
+libbear::thread_pool::
+~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lg{m_};
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& x : workers_) {
+    x.join();
+  }
 }
 
 void
 libbear::thread_pool::
-release() {
-  std::unique_lock<std::mutex> ul{m_};
-  ++free_threads_;
+push(task t) {
+  const std::size_t i = current_pool == this
+    ? current_worker
+    : next_queue_++ % queues_.size();
+  {
+    std::lock_guard<std::mutex> lg{queues_[i]->m};
+    queues_[i]->tasks.push_back(std::move(t));
+  }
+  {
+    std::lock_guard<std::mutex> lg{m_};
+    ++pending_;
+  }
   cv_.notify_one();
 }
 
+void
+libbear::thread_pool::
+push(std::vector<task> ts) {
+  const std::size_t n = ts.size();
+  const std::size_t sz = queues_.size();
+  const std::size_t first = next_queue_.fetch_add(sz);
+  // Tasks are dealt in contiguous blocks, so that every worker starts with
+  // its own share of work and stealing is needed only for load balancing.
+  for (std::size_t q = 0; q < sz; ++q) {
+    const std::size_t b = n * q / sz;
+    const std::size_t e = n * (q + 1) / sz;
+    auto& x = *queues_[(first + q) % sz];
+    std::lock_guard<std::mutex> lg{x.m};
+    std::move(ts.begin() + b, ts.begin() + e, std::back_inserter(x.tasks));
+  }
+  {
+    std::lock_guard<std::mutex> lg{m_};
+    pending_ += n;
+  }
+  cv_.notify_all();
+}
+
+std::optional<libbear::thread_pool::task>
+libbear::thread_pool::
+pop(std::size_t i) {
+  std::optional<task> res{};
+  {
+    auto& x = *queues_[i];
+    std::lock_guard<std::mutex> lg{x.m};
+    if (!x.tasks.empty()) {
+      res = std::move(x.tasks.back());
+      x.tasks.pop_back();
+    }
+  }
+  for (std::size_t j = 1; !res && j < queues_.size(); ++j) {
+    auto& x = *queues_[(i + j) % queues_.size()];
+    std::lock_guard<std::mutex> lg{x.m};
+    if (!x.tasks.empty()) {
+      res = std::move(x.tasks.front());
+      x.tasks.pop_front();
+    }
+  }
+  if (res) {
+    --pending_;
+  }
+  return res;
+}
+
+void
+libbear::thread_pool::
+work(std::size_t i) {
+  current_pool = this;
+  current_worker = i;
+  for (;;) {
+    if (auto t = pop(i)) {
+      (*t)();
+      continue;
+    }
+    std::unique_lock<std::mutex> ul{m_};
+    cv_.wait(ul, [this]() { return stop_ || pending_ != 0; });
+    if (stop_ && pending_ == 0) {
+      return;
+    }
+  }
+}
+
+bool
+libbear::thread_pool::
+is_worker() const {
+  return current_pool == this;
+}
+
+libbear::thread_pool&
+libbear::thread_pool::
+shared() {
+  static thread_pool res{shared_sz};
+  return res;
+}
@@ -1,45 +1,180 @@
 #ifndef LIBBEAR_CORE_THREAD_H
 #define LIBBEAR_CORE_THREAD_H
 
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <cstddef>
+#include <deque>
 #include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 namespace libbear {
 
+  // Fixed set of long-lived workers. Every worker owns a deque of tasks: it
+  // pops tasks from the back of its own deque and, when it runs out of work,
+  // steals from the front of the others. Tasks submitted from outside of the
+  // pool are distributed round-robin.
   class thread_pool {
+  private:
+    using task = std::function<void()>;
+
+    struct task_queue {
+      std::mutex m{};
+      std::deque<task> tasks{};
+    };
+
   public:
-    explicit thread_pool(std::size_t sz) : free_threads_{sz} {}
-
-    template<typename T>
-    std::future<T> async(std::launch policy, const std::function<T()>& f) {
-      return std::async(policy, [this, f]() {
-                          acquire();
-                          if constexpr (std::is_same_v<T, void>) {
-                            f();
-                            release();
-                          } else {
-                            const T res = f();
-                            release();
-                            return res;
-                          }
-                        });
+    explicit thread_pool(std::size_t sz);
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    ~thread_pool();
+
+    std::size_t size() const { return workers_.size(); }
+
+    template<typename F>
+    std::future<std::invoke_result_t<F>> async(F f) {
+      auto [t, res] = make_task(std::move(f));
+      push(std::move(t));
+      return std::move(res);
+    }
+
+    // Bulk submission of f(0), f(1), ..., f(n - 1).
+    template<typename F>
+    std::vector<std::future<std::invoke_result_t<F, std::size_t>>>
+    async_n(std::size_t n, const F& f) {
+      std::vector<std::future<std::invoke_result_t<F, std::size_t>>> res{};
+      std::vector<task> ts{};
+      res.reserve(n);
+      ts.reserve(n);
+      for (std::size_t i = 0; i < n; ++i) {
+        auto [t, r] = make_task([f, i]() { return f(i); });
+        ts.push_back(std::move(t));
+        res.push_back(std::move(r));
+      }
+      push(std::move(ts));
+      return res;
+    }
+
+    // Calls f(0), f(1), ..., f(n - 1) on at most k workers at once. Indices
+    // are taken in increasing order, so f(0), f(1), ... are started first,
+    // which is what longest-processing-time-first scheduling needs when
+    // tasks are sorted by decreasing expected duration. Returns futures of
+    // tasks taking the indices; task stops at the first exception of f.
+    template<typename F>
+    std::vector<std::future<void>>
+    async_for(std::size_t n, std::size_t k, const F& f) {
+      const auto next = std::make_shared<std::atomic_size_t>(0);
+      return async_n(std::min(n, std::max<std::size_t>(k, 1)),
+                     [n, f, next](std::size_t) {
+                       for (std::size_t i; (i = (*next)++) < n;) {
+                         f(i);
+                       }
+                     });
     }
 
+    // Whether calling thread is one of workers of the pool.
+    bool is_worker() const;
+
+    // Pool shared by the library (random_population, fitness calculations,
+    // island model), created on first use with shared_sz workers. Its tasks
+    // should not wait for other tasks of the pool.
+    static thread_pool& shared();
+    static unsigned int shared_sz;
+
   private:
-    void acquire();
-    void release();
+    template<typename F>
+    static auto make_task(F f) {
+      using type = std::invoke_result_t<F>;
+      // std::function requires copyable target, packaged_task is move-only.
+      auto pt = std::make_shared<std::packaged_task<type()>>(std::move(f));
+      auto res = pt->get_future();
+      return std::pair{task{[pt]() { (*pt)(); }}, std::move(res)};
+    }
+
+    void push(task t);
+    void push(std::vector<task> ts);
+    std::optional<task> pop(std::size_t i);
+    void work(std::size_t i);
 
   private:
+    std::vector<std::unique_ptr<task_queue>> queues_{};
+    std::vector<std::thread> workers_{};
+    std::atomic_size_t next_queue_{0};
+    std::atomic_size_t pending_{0};
     std::mutex m_{};
     std::condition_variable cv_{};
-    std::size_t free_threads_;
+    bool stop_{false};
+  };
+
+  // Lock of very short critical sections. Unlike std::mutex, it is released
+  // by plain store, which does not stall the memory accesses following it,
+  // so uncontended locking costs less. Waiting thread yields, as the holder
+  // might have been preempted.
+  class spin_lock {
+  public:
+    void lock() {
+      while (locked_.exchange(true, std::memory_order_acquire)) {
+        while (locked_.load(std::memory_order_relaxed)) {
+          std::this_thread::yield();
+        }
+      }
+    }
+
+    bool try_lock() {
+      return !locked_.load(std::memory_order_relaxed)
+        && !locked_.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock() { locked_.store(false, std::memory_order_release); }
+
+  private:
+    std::atomic_bool locked_{false};
+  };
+
+  // Results of concurrently running tasks in order of their completion.
+  template<typename T>
+  class completion_queue {
+  public:
+    void push(T t) {
+      {
+        std::lock_guard<std::mutex> lg{m_};
+        results_.push_back(std::move(t));
+      }
+      cv_.notify_one();
+    }
+
+    // Waits for the result if there is none.
+    T pop() {
+      std::unique_lock<std::mutex> ul{m_};
+      cv_.wait(ul, [this]() { return !results_.empty(); });
+      T res = std::move(results_.front());
+      results_.pop_front();
+      return res;
+    }
+
+    std::optional<T> try_pop() {
+      std::lock_guard<std::mutex> lg{m_};
+      if (results_.empty()) {
+        return std::nullopt;
+      }
+      T res = std::move(results_.front());
+      results_.pop_front();
+      return res;
+    }
+
+  private:
+    std::mutex m_{};
+    std::condition_variable cv_{};
+    std::deque<T> results_{};
   };
 
 } // namespace libbear
 
 #endif // LIBBEAR_CORE_THREAD_H
-
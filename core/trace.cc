@@ -0,0 +1,160 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <ratio>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <libbear/core/trace.h>
+
+namespace {
+
+  struct event {
+    const char* name;
+    std::int64_t begin;
+    std::int64_t end;
+  };
+
+  // Written by its thread only; mutex is contended only during export.
+  struct ring {
+    explicit ring(std::size_t t) : tid{t} {}
+
+    const std::size_t tid;
+    std::mutex m{};
+    std::vector<event> events{};
+    // Number of events ever written.
+    std::size_t written{0};
+  };
+
+  static_assert(std::is_same_v<std::chrono::steady_clock::period, std::nano>);
+
+  const std::int64_t origin{
+    std::chrono::steady_clock::now().time_since_epoch().count()
+  };
+
+  std::mutex registry_mutex{};
+  std::vector<std::shared_ptr<ring>> registry{};
+  // Rings of finished threads.
+  std::vector<std::shared_ptr<ring>> idle{};
+
+  // Ring of thread, handed back to idle rings on thread exit.
+  class ring_lease {
+  public:
+    ring_lease() {
+      std::lock_guard<std::mutex> lg{registry_mutex};
+      if (idle.empty()) {
+        registry.push_back(std::make_shared<ring>(registry.size() + 1));
+        r_ = registry.back();
+      } else {
+        r_ = std::move(idle.back());
+        idle.pop_back();
+      }
+    }
+
+    ring_lease(const ring_lease&) = delete;
+    ring_lease& operator=(const ring_lease&) = delete;
+
+    ~ring_lease() {
+      std::lock_guard<std::mutex> lg{registry_mutex};
+      idle.push_back(std::move(r_));
+    }
+
+    ring& get() const { return *r_; }
+
+  private:
+    std::shared_ptr<ring> r_;
+  };
+
+  ring& local_ring() {
+    thread_local const ring_lease res{};
+    return res.get();
+  }
+
+  // Nanoseconds in microseconds, as required by the format.
+  void timestamp(std::ostream& os, std::int64_t ns) {
+    os << ns / 1000 << '.' << static_cast<char>('0' + ns / 100 % 10)
+       << static_cast<char>('0' + ns / 10 % 10)
+       << static_cast<char>('0' + ns % 10);
+  }
+
+  void name(std::ostream& os, const char* s) {
+    os << '"';
+    for (; *s; ++s) {
+      if (*s == '"' || *s == '\\') {
+        os << '\\';
+      }
+      os << *s;
+    }
+    os << '"';
+  }
+
+}
+
+void
+libbear::trace_span::
+record(const char* name, std::int64_t begin, std::int64_t end) {
+  auto& r = local_ring();
+  std::lock_guard<std::mutex> lg{r.m};
+  if (r.events.size() < capacity) {
+    r.events.push_back(event{name, begin, end});
+  } else {
+    r.events[r.written % capacity] = event{name, begin, end};
+  }
+  ++r.written;
+}
+
+void
+libbear::
+write_trace(std::ostream& os) {
+  std::vector<std::shared_ptr<ring>> rs{};
+  {
+    std::lock_guard<std::mutex> lg{registry_mutex};
+    rs = registry;
+  }
+  os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first{true};
+  for (const auto& r : rs) {
+    std::lock_guard<std::mutex> lg{r->m};
+    // Oldest event first.
+    const std::size_t n = r->events.size();
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto& e = r->events[(r->written + i) % n];
+      os << (first ? "" : ",") << "\n{\"name\":";
+      name(os, e.name);
+      os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << r->tid << ",\"ts\":";
+      timestamp(os, e.begin - origin);
+      os << ",\"dur\":";
+      timestamp(os, e.end - e.begin);
+      os << '}';
+      first = false;
+    }
+  }
+  os << "\n]}\n";
+}
+
+void
+libbear::
+save_trace(const std::string& filename) {
+  std::ofstream file{filename};
+  if (!file) {
+    throw std::runtime_error{"save_trace: cannot open " + filename};
+  }
+  write_trace(file);
+}
+
+void
+libbear::
+clear_trace() {
+  std::lock_guard<std::mutex> lg{registry_mutex};
+  for (const auto& r : registry) {
+    std::lock_guard<std::mutex> lgr{r->m};
+    r->events.clear();
+    r->written = 0;
+  }
+}
@@ -0,0 +1,62 @@
+#ifndef LIBBEAR_CORE_TRACE_H
+#define LIBBEAR_CORE_TRACE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Spans of time (e.g. phases of evolution) recorded per thread and exported
+// in Chrome trace event format, which is read by chrome://tracing and
+// Perfetto. TRACE_SPAN("name") records time from its point of declaration
+// to the end of enclosing scope. Spans are compiled in only if LIBBEAR_TRACE
+// is defined (make TRACE=1 for the library itself), otherwise the macro
+// expands to nothing.
+
+#define LIBBEAR_TRACE_CONCAT_(a, b) a##b
+#define LIBBEAR_TRACE_CONCAT(a, b) LIBBEAR_TRACE_CONCAT_(a, b)
+
+#ifdef LIBBEAR_TRACE
+#define TRACE_SPAN(name) \
+const ::libbear::trace_span LIBBEAR_TRACE_CONCAT(trace_span_, __LINE__){name}
+#else
+#define TRACE_SPAN(name) static_cast<void>(0)
+#endif
+
+namespace libbear {
+
+  // Name has to be string literal (or other string of static storage
+  // duration). Every thread keeps the last capacity spans in its ring
+  // buffer. Buffer of finished thread keeps its spans and is taken over by
+  // the next new thread, so there are at most as many buffers as threads
+  // running at once.
+  class trace_span {
+  public:
+    static constexpr std::size_t capacity{std::size_t{1} << 16};
+
+    explicit trace_span(const char* name) : name_{name}, begin_{now()} {}
+    trace_span(const trace_span&) = delete;
+    trace_span& operator=(const trace_span&) = delete;
+    ~trace_span() { record(name_, begin_, now()); }
+
+  private:
+    static std::int64_t now()
+    { return std::chrono::steady_clock::now().time_since_epoch().count(); }
+
+    static void record(const char* name, std::int64_t begin, std::int64_t end);
+
+  private:
+    const char* const name_;
+    const std::int64_t begin_;
+  };
+
+  // Spans of all threads as Chrome trace JSON; spans may be recorded in the
+  // meantime.
+  void write_trace(std::ostream& os);
+  void save_trace(const std::string& filename);
+  void clear_trace();
+
+} // namespace libbear
+
+#endif // LIBBEAR_CORE_TRACE_H
@@ -0,0 +1,64 @@
+#include <cmath>
+#include <ios>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <libbear/ea/accounting.h>
+#include <libbear/ea/elements.h>
+#include <libbear/ea/fitness.h>
+
+libbear::evaluation_accounting::
+evaluation_accounting(const std::string& filename) {
+  if (!filename.empty()) {
+    file_.open(filename, std::ios::app);
+    if (!file_) {
+      throw std::runtime_error{"evaluation_accounting: cannot open "
+                               + filename};
+    }
+    file_.precision(std::numeric_limits<fitness>::max_digits10);
+  }
+}
+
+void
+libbear::evaluation_accounting::
+record(const evaluation_record& r) {
+  ++calculations_;
+  if (r.value == incalculable) {
+    ++incalculable_;
+  }
+  if (r.interrupted) {
+    ++interrupted_;
+  }
+  wall_time_.record(r.wall_time.count());
+  if (r.commands != 0) {
+    cpu_time_.record(r.cpu_time.count());
+    peak_rss_.record(r.peak_rss);
+  }
+  if (!file_.is_open()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lg{m_};
+  file_ << "{\"hash\":" << r.hash
+        << ",\"start_ns\":" << r.start.count()
+        << ",\"wall_ns\":" << r.wall_time.count()
+        << ",\"commands\":" << r.commands
+        << ",\"cpu_ns\":" << r.cpu_time.count()
+        << ",\"peak_rss\":" << r.peak_rss
+        << ",\"fitness\":";
+  // JSON has no infinities nor NaN.
+  if (!std::isfinite(r.value)) {
+    file_ << "null";
+  } else {
+    file_ << r.value;
+  }
+  file_ << ",\"interrupted\":" << (r.interrupted ? "true" : "false") << "}"
+        << std::endl;
+}
+
+libbear::evaluation_counters
+libbear::evaluation_accounting::
+counters() const {
+  return evaluation_counters{hits_, calculations_, incalculable_,
+                             interrupted_};
+}
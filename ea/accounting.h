@@ -0,0 +1,78 @@
+#ifndef LIBBEAR_EA_ACCOUNTING_H
+#define LIBBEAR_EA_ACCOUNTING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <libbear/core/histogram.h>
+#include <libbear/ea/elements.h>
+
+namespace libbear {
+
+  // One fitness calculation.
+  struct evaluation_record {
+    // Hash of genotype.
+    std::size_t hash{0};
+    // Since creation of accounting.
+    std::chrono::nanoseconds start{0};
+    std::chrono::nanoseconds wall_time{0};
+    // Resources of commands run with execute() during calculation.
+    std::size_t commands{0};
+    std::chrono::nanoseconds cpu_time{0};
+    std::size_t peak_rss{0}; // bytes
+    fitness value{0.};
+    // Calculation ended with execution_interrupted.
+    bool interrupted{false};
+  };
+
+  struct evaluation_counters {
+    // Fitness values taken from cache or storage.
+    std::size_t hits{0};
+    std::size_t calculations{0};
+    std::size_t incalculable{0};
+    std::size_t interrupted{0};
+  };
+
+  // Resource accounting of fitness function (see fitness_function::
+  // accounting): counters, histograms of calculations and, optionally, every
+  // calculation written as JSON line to file. Safe for concurrent use.
+  class evaluation_accounting {
+  public:
+    // Empty filename means no JSON lines.
+    explicit evaluation_accounting(const std::string& filename = "");
+    evaluation_accounting(const evaluation_accounting&) = delete;
+    evaluation_accounting& operator=(const evaluation_accounting&) = delete;
+
+    void hit() { ++hits_; }
+    void record(const evaluation_record& r);
+
+    evaluation_counters counters() const;
+    // In nanoseconds.
+    const histogram& wall_time() const { return wall_time_; }
+    const histogram& cpu_time() const { return cpu_time_; }
+    // In bytes.
+    const histogram& peak_rss() const { return peak_rss_; }
+
+    std::chrono::steady_clock::time_point origin() const { return origin_; }
+
+  private:
+    const std::chrono::steady_clock::time_point origin_{
+      std::chrono::steady_clock::now()
+    };
+    std::atomic_size_t hits_{0};
+    std::atomic_size_t calculations_{0};
+    std::atomic_size_t incalculable_{0};
+    std::atomic_size_t interrupted_{0};
+    histogram wall_time_{};
+    histogram cpu_time_{};
+    histogram peak_rss_{};
+    std::mutex m_{};
+    std::ofstream file_{};
+  };
+
+} // namespace libbear
+
+#endif // LIBBEAR_EA_ACCOUNTING_H
@@ -8,8 +8,11 @@
 namespace libbear {
 
   class genotype;
+  struct individual;
   
   using population = std::vector<genotype>;
+  // Genotypes together with their fitnesses (see individual.h).
+  using evaluated_population = std::vector<individual>;
   using fitness = double;
   using fitnesses = std::vector<fitness>;
   
@@ -27,24 +30,35 @@ namespace libbear {
   using recombination_fn =
     std::function<population(const genotype&, const genotype&)>;
   
-  // Population generators/selectors
+  // Population generators/selectors, selections work on evaluated
+  // populations, so fitness of every genotype is calculated once
   // - first generation creator
   using populate_0_fn =
     std::function<population(std::size_t)>;
   // - parents selection
   using populate_1_fn =
-    std::function<population(std::size_t, population)>;
+    std::function<evaluated_population(std::size_t,
+                                       const evaluated_population&)>;
   // - survivor selection
   using populate_2_fn =
-    std::function<population(std::size_t, population, population)>;
+    std::function<evaluated_population(std::size_t,
+                                       evaluated_population,
+                                       evaluated_population)>;
+  // - selection returning indices of selected genotypes instead of copies
+  using selection = std::vector<std::size_t>;
+  using index_selection_fn =
+    std::function<selection(std::size_t, const evaluated_population&)>;
   
   using populate_fns =
     std::tuple<populate_0_fn, populate_1_fn, populate_2_fn>;
   
   using generations =
-    std::vector<population>;
+    std::vector<evaluated_population>;
   using termination_condition =
     std::function<bool(std::size_t, const generations&)>;
+  // Called with number and population of every generation created.
+  using generation_observer =
+    std::function<void(std::size_t, const evaluated_population&)>;
   
   using genotype_constraints = std::function<bool(const genotype&)>;
 
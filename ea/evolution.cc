@@ -1,52 +1,382 @@
-#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <barrier>
 #include <cstddef>
+#include <deque>
+#include <exception>
 #include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 #include <vector>
 #include <libbear/core/debug.h>
+#include <libbear/core/random.h>
+#include <libbear/core/thread.h>
+#include <libbear/core/trace.h>
 #include <libbear/ea/elements.h>
 #include <libbear/ea/fitness.h>
 #include <libbear/ea/evolution.h>
 #include <libbear/ea/genotype.h>
+#include <libbear/ea/population.h>
+#include <libbear/ea/statistics.h>
 
-libbear::population
+libbear::evaluated_population
 libbear::generation_creator::
 operator()() const {
+  TRACE_SPAN("generation_creator");
   const auto& [p0, p1, p2] = populate_;
-  current_generation_ = first_use_
-    ? p0(options_.generation_sz)
-    : p2(options_.generation_sz,
-         current_generation_,
-         options_.variate(p1(options_.parents_sz,
-                             current_generation_)));
+  if (first_use_) {
+    TRACE_SPAN("first generation");
+    current_generation_ = ff_.evaluate(p0(options_.generation_sz));
+  } else {
+    const auto& cg = current_generation_;
+    population offspring{};
+    if (select_parents_) {
+      selection s{};
+      {
+        TRACE_SPAN("parents selection");
+        s = select_parents_(options_.parents_sz, cg);
+      }
+      offspring = options_.variate(cg, s);
+    } else {
+      evaluated_population parents{};
+      {
+        TRACE_SPAN("parents selection");
+        parents = p1(options_.parents_sz, cg);
+      }
+      offspring = options_.variate(genotypes(parents));
+    }
+    evaluated_population evaluated{ff_.evaluate(std::move(offspring))};
+    TRACE_SPAN("survivor selection");
+    // Current generation is not needed any more, it is moved to p2 along
+    // with the offspring.
+    current_generation_ = p2(options_.generation_sz,
+                             std::move(current_generation_),
+                             std::move(evaluated));
+  }
   first_use_ = false;
-  return current_generation_;
+  return share(current_generation_);
 }
   
+void
+libbear::generation_creator::
+current_generation(const evaluated_population& p) {
+  current_generation_ = p;
+  first_use_ = false;
+}
+
+namespace {
+
+  void record(libbear::generations& gs, libbear::evaluated_population p,
+              std::size_t window) {
+    if (gs.size() == window) {
+      gs.erase(gs.begin());
+    }
+    gs.push_back(std::move(p));
+  }
+
+}
+
 libbear::generations
 libbear::evolution::
 operator()() const {
+  return run(nullptr, unlimited);
+}
+
+void
+libbear::evolution::
+operator()(const generation_observer& o, std::size_t window) const {
+  if (window == 0) {
+    throw std::invalid_argument{"evolution: bad window"};
+  }
+  run(o, window);
+}
+
+libbear::generations
+libbear::evolution::
+run(const generation_observer& o, std::size_t window) const {
+  TRACE_SPAN("evolution");
   generations res{};
-  for (std::size_t i = 0; !terminate_(i++, res);) {
+  const auto terminated = [this, &res](std::size_t i) {
+    TRACE_SPAN("termination condition");
+    return terminate_(i, res);
+  };
+  for (std::size_t i = 0; !terminated(i++);) {
     DEBUG_MSG("Generation #" << i);
-    res.push_back(create_generation_());
+    evaluated_population p{create_generation_()};
+    if (o) {
+      TRACE_SPAN("generation observer");
+      o(i - 1, p);
+    }
+    record(res, std::move(p), window);
+  }
+  return res;
+}
+
+libbear::steady_state_evolution::
+steady_state_evolution(const populate_fns& p,
+                       const options& o,
+                       const fitness_function& ff,
+                       const termination_condition& tc)
+  : populate_{p}, options_{o}, ff_{ff}, terminate_{tc} {
+  if (o.population_sz == 0 || o.parents_sz == 0 || o.parents_sz % 2 != 0
+      || o.in_flight == 0) {
+    throw std::invalid_argument{"steady_state_evolution: bad options"};
+  }
+}
+
+libbear::generations
+libbear::steady_state_evolution::
+operator()() const {
+  return run(nullptr, evolution::unlimited);
+}
+
+void
+libbear::steady_state_evolution::
+operator()(const generation_observer& o, std::size_t window) const {
+  if (window == 0) {
+    throw std::invalid_argument{"steady_state_evolution: bad window"};
+  }
+  run(o, window);
+}
+
+libbear::generations
+libbear::steady_state_evolution::
+run(const generation_observer& o, std::size_t window) const {
+  const auto& [p0, p1, p2] = populate_;
+  generations res{};
+  std::size_t i{0};
+  const auto next = [&](const evaluated_population& p) {
+    if (o) {
+      o(i - 1, p);
+    }
+    record(res, share(p), window);
+    return terminate_(i++, res);
+  };
+  if (terminate_(i++, res)) {
+    return res;
+  }
+  evaluated_population current{ff_.evaluate(p0(options_.population_sz))};
+  if (next(current)) {
+    return res;
+  }
+
+  struct result {
+    individual x;
+    std::exception_ptr error;
+  };
+  completion_queue<result> results{};
+  // Calculations queued, but not started yet, are skipped after the end.
+  std::atomic_bool stop{false};
+  std::deque<genotype> bred{};
+  const auto submit = [&](thread_pool& tp) {
+    while (bred.empty()) {
+      for (auto& g :
+             options_.variate(genotypes(p1(options_.parents_sz, current)))) {
+        bred.push_back(std::move(g));
+      }
+    }
+    tp.async([this, &results, &stop, g = std::move(bred.front())]() {
+      if (!stop) {
+        try {
+          const fitness f = ff_(g);
+          results.push(result{individual{g, f}, nullptr});
+        } catch (...) {
+          results.push(result{individual{g, incalculable},
+                              std::current_exception()});
+        }
+      }
+    });
+    bred.pop_front();
+  };
+
+  thread_pool tp{options_.in_flight};
+  struct stopper {
+    std::atomic_bool& s;
+    ~stopper() { s = true; }
+  } const st{stop};
+  for (std::size_t j = 0; j < options_.in_flight; ++j) {
+    submit(tp);
+  }
+  for (std::size_t n = 1;; ++n) {
+    result r{results.pop()};
+    if (r.error) {
+      std::rethrow_exception(r.error);
+    }
+    DEBUG_MSG("Steady-state insertion #" << n);
+    evaluated_population offspring{};
+    offspring.push_back(std::move(r.x));
+    current = p2(options_.population_sz, std::move(current),
+                 std::move(offspring));
+    submit(tp);
+    if (n % options_.population_sz == 0 && next(current)) {
+      return res;
+    }
+  }
+}
+
+libbear::island_model::
+island_model(const std::vector<generation_creator>& islands,
+             const fitness_function& ff,
+             const options& o,
+             const termination_condition& tc)
+  : islands_{islands}, ff_{ff}, options_{o}, terminate_{tc} {
+  if (islands.empty() || o.interval == 0) {
+    throw std::invalid_argument{"island_model: bad options"};
+  }
+}
+
+std::vector<libbear::generations>
+libbear::island_model::
+operator()() const {
+  const std::size_t n = islands_.size();
+  std::vector<generation_creator> gcs{islands_};
+  std::vector<generations> res(n);
+  // Migrants are published in one of two buffers alternately. Island
+  // publishes k-th migrants after passing (k - 1)-th barrier, which all
+  // islands pass only after reading (k - 2)-th migrants from the same buffer.
+  std::vector<evaluated_population> migrants[2]{
+    std::vector<evaluated_population>(n), std::vector<evaluated_population>(n)
+  };
+  std::barrier sync{static_cast<std::ptrdiff_t>(n)};
+  std::vector<std::exception_ptr> errors(n);
+  // Condition might have state, e.g. statistics of the run, so every island
+  // has its own copy.
+  std::vector<termination_condition> terminate(n, terminate_);
+  // Streams of first generations and then of island threads.
+  const auto streams = reserve_random_streams(2 * n);
+
+  const auto best = [this](const evaluated_population& p) {
+    selection idx(p.size());
+    std::iota(idx.begin(), idx.end(), std::size_t{0});
+    const std::size_t m = std::min(options_.migrants_sz, p.size());
+    std::ranges::partial_sort(idx, idx.begin() + m,
+                              [&p](std::size_t a, std::size_t b) {
+                                return p[a].f > p[b].f;
+                              });
+    idx.resize(m);
+    return select(p, idx);
+  };
+
+  const auto sources = [this, n](std::size_t i) -> std::vector<std::size_t> {
+    if (n == 1) {
+      return {};
+    }
+    switch (options_.topology) {
+    case migration_topology::ring:
+      return {(i + n - 1) % n};
+    case migration_topology::star:
+      if (i == 0) {
+        std::vector<std::size_t> res(n - 1);
+        std::iota(res.begin(), res.end(), std::size_t{1});
+        return res;
+      }
+      return {0};
+    case migration_topology::random:
+      break;
+    }
+    const auto j = random_from_uniform_distribution<std::size_t>(0, n - 2);
+    return {j < i ? j : j + 1};
+  };
+
+  const auto run = [&](std::size_t i) {
+    const random_stream rs{streams + n + i};
+    auto& gs = res[i];
+    try {
+      // Empty gs means that island has terminated before its first
+      // generation or failed to create it.
+      for (std::size_t k = 0, j = 1; !gs.empty(); ++j) {
+        if (j % options_.interval == 0) {
+          auto& buffer = migrants[k++ % 2];
+          buffer[i] = best(gs.back());
+          sync.arrive_and_wait();
+          evaluated_population immigrants{};
+          for (const auto x : sources(i)) {
+            immigrants.insert(immigrants.end(), buffer[x].begin(),
+                              buffer[x].end());
+          }
+          const auto& current = gs.back();
+          gcs[i].current_generation(
+            replace_worst_survivor_selection{ff_}(current.size(), current,
+                                                  immigrants));
+        }
+        if (terminate[i](j, gs)) {
+          break;
+        }
+        DEBUG_MSG("Island #" << i << ", generation #" << j + 1);
+        gs.push_back(gcs[i]());
+      }
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+    // Finished island does not hold the others at the next barriers.
+    sync.arrive_and_drop();
+  };
+
+  // First generations are created here, one island after another, so that
+  // streams reserved inside (e.g. by random_population) do not depend on
+  // scheduling of island threads.
+  for (std::size_t i = 0; i < n; ++i) {
+    try {
+      if (!terminate[i](0, res[i])) {
+        DEBUG_MSG("Island #" << i << ", generation #1");
+        const random_stream rs{streams + i};
+        res[i].push_back(gcs[i]());
+      }
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  }
+  std::vector<std::thread> ts{};
+  for (std::size_t i = 0; i < n; ++i) {
+    ts.emplace_back(run, i);
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+  for (const auto& e : errors) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
   }
   return res;
 }
 
+libbear::termination_condition
+libbear::statistics_termination(const fitness_function& ff,
+                                const statistics_condition& sc) {
+  return [rs = run_statistics{ff}, sc](std::size_t i,
+                                       const generations& gs) mutable {
+    if (i == 0) {
+      rs.clear();
+    } else if (rs.size() < i && !gs.empty()) {
+      rs.update(gs.back());
+    }
+    return sc(rs);
+  };
+}
+
 libbear::termination_condition
 libbear::max_fitness_improvement_termination(const fitness_function& ff,
                                              std::size_t n,
                                              double frac) {
-  return [=]([[maybe_unused]] std::size_t i, const generations& gs) {
-    assert(i == gs.size());
-    if (gs.size() <= n) {
+  return statistics_termination(ff, [=](const run_statistics& rs) {
+    if (rs.size() <= n) {
       return false;
-    } else {
-      const fitnesses fs{max(gs, ff)};
-      const fitness min_last_n = *std::min_element(fs.end() - n, fs.end());
-      const double x = (max(fs) - min_last_n) / (max(fs) - min(fs));
-      return x <= frac;
     }
-  };
+    const auto& h = rs.history();
+    const auto min_last_n = std::ranges::min_element(
+      h.end() - n, h.end(), {}, &generation_statistics::best)->best;
+    const double x =
+      (rs.best() - min_last_n) / (rs.best() - rs.worst_best());
+    return x <= frac;
+  });
 }
 
+libbear::termination_condition
+libbear::stagnation_termination(const fitness_function& ff, std::size_t n) {
+  return statistics_termination(ff, [=](const run_statistics& rs) {
+    return rs.size() != 0 && rs.stagnation() >= n;
+  });
+}
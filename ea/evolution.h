@@ -2,12 +2,19 @@
 #define LIBBEAR_EVOLUTION_H
 
 #include <cstddef>
+#include <functional>
+#include <limits>
+#include <vector>
 #include <libbear/ea/elements.h>
 #include <libbear/ea/fitness.h>
+#include <libbear/ea/population.h>
+#include <libbear/ea/statistics.h>
 #include <libbear/ea/variation.h>
 
 namespace libbear {
 
+  // Every genotype is evaluated with ff once, when it enters the first
+  // generation or offspring. Selections read fitness stored with it.
   class generation_creator {
   public:
     struct options {
@@ -16,41 +23,167 @@ namespace libbear {
       const std::size_t parents_sz;
     };
     
-    generation_creator(const populate_fns& p, const options& o)
-      : populate_{p}, options_{o}
+    generation_creator(const populate_fns& p,
+                       const options& o,
+                       const fitness_function& ff)
+      : populate_{p}, options_{o}, ff_{ff}
     {}
 
-    population operator()() const;
+    // Parents are selected as indices, so they are not copied before
+    // variation.
+    generation_creator(const populate_0_fn& p0,
+                       const index_selection_fn& p1,
+                       const populate_2_fn& p2,
+                       const options& o,
+                       const fitness_function& ff)
+      : populate_{p0, materialize(p1), p2}
+      , select_parents_{p1}
+      , options_{o}
+      , ff_{ff}
+    {}
+
+    evaluated_population operator()() const;
+
+    // Population created most recently.
+    const evaluated_population& current_generation() const
+    { return current_generation_; }
+    // Next generation will be created from p, e.g. after migration.
+    void current_generation(const evaluated_population& p);
     
   private:
     const populate_fns populate_;
+    const index_selection_fn select_parents_{};
     const options options_;
+    const fitness_function ff_;
     mutable bool first_use_{true};
-    mutable population current_generation_{};
+    mutable evaluated_population current_generation_{};
   };
   
   class evolution {
   public:
+    static constexpr std::size_t unlimited{
+      std::numeric_limits<std::size_t>::max()
+    };
+
     evolution(const generation_creator& gc, const termination_condition& tc)
       : create_generation_{gc}, terminate_{tc}
     {}
 
     generations operator()() const;
+    // Generations are passed to observer as soon as they are created. Only
+    // last window generations are kept for termination condition, so memory
+    // does not grow with the number of generations. Window has to be
+    // positive, as termination conditions need the last generation.
+    void operator()(const generation_observer& o,
+                    std::size_t window = unlimited) const;
     
+  private:
+    generations run(const generation_observer& o, std::size_t window) const;
+
   private:
     const generation_creator create_generation_;
     const termination_condition terminate_;
   };
   
+  // Asynchronous steady-state evolution. Instead of waiting for the whole
+  // offspring population, options.in_flight fitness calculations are kept
+  // running all the time. Whenever one of them finishes, the individual is
+  // inserted into population by survivor selection (called with offspring of
+  // size one) and replacement is bred and submitted at once. Population is
+  // recorded as a generation after every population_sz calculations, so
+  // usual termination conditions can be used. Order of completions depends
+  // on timing, therefore results are not reproducible. Parents are paired
+  // for recombination, so options.parents_sz has to be even and nonzero.
+  class steady_state_evolution {
+  public:
+    struct options {
+      const variation variate;
+      const std::size_t population_sz;
+      const std::size_t parents_sz;
+      const std::size_t in_flight;
+    };
+
+    steady_state_evolution(const populate_fns& p,
+                           const options& o,
+                           const fitness_function& ff,
+                           const termination_condition& tc);
+
+    generations operator()() const;
+    // See evolution::operator()(o, window).
+    void operator()(const generation_observer& o,
+                    std::size_t window = evolution::unlimited) const;
+
+  private:
+    generations run(const generation_observer& o, std::size_t window) const;
+
+  private:
+    const populate_fns populate_;
+    const options options_;
+    const fitness_function ff_;
+    const termination_condition terminate_;
+  };
+
+  enum class migration_topology {
+    ring,   // island i receives migrants from island i - 1
+    star,   // island 0 receives from all the others and sends to them
+    random  // every island receives from other island drawn each time
+  };
+
+  // Island model: every generation creator evolves its own subpopulation on
+  // a separate thread. Every interval generations each island publishes its
+  // migrants_sz best individuals, which replace the worst individuals of
+  // receiving islands (if they are better). Islands meet only at migration,
+  // so there is no lock on a shared population. Island stops when the
+  // termination condition applied to its own generations is met. Fitness
+  // calculations of all islands share thread_pool::shared().
+  class island_model {
+  public:
+    struct options {
+      const migration_topology topology;
+      const std::size_t interval;
+      const std::size_t migrants_sz;
+    };
+
+    island_model(const std::vector<generation_creator>& islands,
+                 const fitness_function& ff,
+                 const options& o,
+                 const termination_condition& tc);
+
+    // Generations of every island.
+    std::vector<generations> operator()() const;
+
+  private:
+    const std::vector<generation_creator> islands_;
+    const fitness_function ff_;
+    const options options_;
+    const termination_condition terminate_;
+  };
+
   inline termination_condition max_iterations_termination(std::size_t max) {
     return [=](std::size_t i, const generations&) { return i == max; };
   }
 
+  using statistics_condition = std::function<bool(const run_statistics&)>;
+
+  // Termination condition evaluated on run_statistics, which are updated
+  // with the last generation only. Every copy of the condition keeps its own
+  // statistics, which are reset when a new run starts (i == 0).
+  termination_condition
+  statistics_termination(const fitness_function& ff,
+                         const statistics_condition& sc);
+
+  // Terminates when the best fitnesses of last n generations are close to the
+  // best one: (best - min. of last n) / (best - min.) <= frac, where all the
+  // values are the best fitnesses of generations.
   termination_condition
   max_fitness_improvement_termination(const fitness_function& ff,
                                       std::size_t n,
                                       double frac);
 
+  // Terminates when the best fitness has not improved for n generations.
+  termination_condition stagnation_termination(const fitness_function& ff,
+                                               std::size_t n);
+
 }
 
 #endif // LIBBEAR_EVOLUTION_H
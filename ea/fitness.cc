@@ -1,76 +1,299 @@
 #include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
 #include <cstddef>
+#include <cstdlib>
+#include <exception>
 #include <iterator>
+#include <memory>
 #include <future>
 #include <limits>
 #include <numeric>
+#include <optional>
 #include <stdexcept>
+#include <string>
 #include <thread>
-#include <unordered_set>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <libbear/core/debug.h>
+#include <libbear/core/system.h>
 #include <libbear/core/thread.h>
+#include <libbear/core/trace.h>
+#include <libbear/ea/accounting.h>
 #include <libbear/ea/elements.h>
 #include <libbear/ea/fitness.h>
 #include <libbear/ea/genotype.h>
+#include <libbear/ea/individual.h>
 
 unsigned int
 libbear::fitness_function::thread_sz = std::thread::hardware_concurrency();
 
-// TODO: Consider memoization.
 libbear::fitness
 libbear::fitness_function::
 operator()(const genotype& g) const {
-  auto it{ fitness_values_->find(g) };
-  const auto p = it != fitness_values_->end();
-  const auto str = p ? "Fitness taken from database"
+  const auto f = known(g);
+  const auto str = f ? "Fitness taken from database"
                      : "Fitness must be calculated";
   DEBUG_MSG(str);
-  return p ? it->second  : ((*fitness_values_)[g] = function_(g));
+  return f ? *f : calculate(g);
 }
 
 libbear::fitnesses
 libbear::fitness_function::
 operator()(const population& p) const {
-  if (thread_sz > 1 && p.size() > 1) {
-    multithreaded_calculations(p);
+  fitnesses res(p.size(), incalculable);
+  std::vector<const genotype*> unknown{};
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    if (const auto f = known(p[i])) {
+      res[i] = *f;
+    } else {
+      unknown.push_back(&p[i]);
+    }
+  }
+  if (!unknown.empty()) {
+    // Values are taken from the stream, as cache of limited capacity might
+    // have already evicted some of them.
+    fitness_stream fs{*this, unknown};
+    while (const auto x = fs.next()) {
+      res[x->first - p.data()] = x->second;
+    }
   }
-  fitnesses res{};
-  std::ranges::transform(p, std::back_inserter(res),
-                         [this](const genotype& g) { return operator()(g); });
   return res;
 }
 
-libbear::fitness_function::unique_genotypes
+libbear::evaluated_population
 libbear::fitness_function::
-uncalculated_fitness(const population& p) const {
-  std::unordered_set<genotype> res{};
-  std::ranges::copy_if(p, std::inserter(res, std::end(res)),
-                       [this](const genotype& g) {
-                         return !fitness_values_->contains(g);
-                       });
+evaluate(population p) const {
+  const fitnesses fs{operator()(p)};
+  evaluated_population res{};
+  res.reserve(p.size());
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    res.push_back(individual{std::move(p[i]), fs[i]});
+  }
   return res;
 }
 
-void
+std::optional<libbear::fitness>
+libbear::fitness_function::
+known(const genotype& g) const {
+  auto f = fitness_values_->find(g);
+  if (!f && storage_) {
+    f = storage_->find(g.encode());
+    if (f) {
+      fitness_values_->insert(g, *f);
+    }
+  }
+  if (f && accounting_) {
+    accounting_->hit();
+  }
+  return f;
+}
+
+libbear::fitness
+libbear::fitness_function::
+calculate(const genotype& g) const {
+  // Concurrent calculations of the same genotype are joined by the cache.
+  return fitness_values_->compute(g, [this, &g]() {
+    const auto [res, interrupted] = accounting_ ? accounted_invoke(g)
+                                                : invoke(g);
+    if (storage_ && !interrupted) {
+      storage_->insert(g.encode(), res);
+    }
+    return res;
+  });
+}
+
+std::pair<libbear::fitness, bool>
+libbear::fitness_function::
+invoke(const genotype& g) const {
+  if (stop_.stop_requested()) {
+    return {interrupted_, true};
+  }
+  // Limits are applied to commands run by function on this thread.
+  auto& limits = thread_execution_limits();
+  const execution_limits saved{limits};
+  if (timeout_.count() > 0) {
+    limits.deadline = std::min(limits.deadline,
+                               std::chrono::steady_clock::now() + timeout_);
+  }
+  if (stop_.stop_possible()) {
+    limits.stop = stop_;
+  }
+  std::pair<fitness, bool> res{};
+  try {
+    res = {function_(g), false};
+  } catch (const execution_interrupted&) {
+    res = {interrupted_, true};
+  } catch (const execution_failed&) {
+    res = {incalculable, false};
+  } catch (...) {
+    limits = saved;
+    throw;
+  }
+  limits = saved;
+  return res;
+}
+
+std::pair<libbear::fitness, bool>
 libbear::fitness_function::
-multithreaded_calculations(const population& p) const {
-  DEBUG_MSG("Multithreaded calculations: begin");
-  using type = std::pair<genotype, fitness>;
-  thread_pool tp{thread_sz};
-  std::vector<std::future<type>> v{};
-  for (const auto& x : uncalculated_fitness(p)) {
-    v.push_back(tp.async<type>(std::launch::async, [this, x]() {
-                  DEBUG_MSG("Asynchronous fitness calculations");
-                  const fitness xf = this->function_(x);
-                  return type{x, xf};
-                }));
+accounted_invoke(const genotype& g) const {
+  using clock = std::chrono::steady_clock;
+  // Commands run by function on this thread are counted apart from those
+  // run before.
+  auto& usage = thread_execution_usage();
+  const execution_usage saved{std::exchange(usage, execution_usage{})};
+  const auto start = clock::now();
+  std::pair<fitness, bool> res{};
+  try {
+    res = invoke(g);
+  } catch (...) {
+    usage += saved;
+    throw;
+  }
+  evaluation_record r{};
+  r.hash = g.hash();
+  r.start = start - accounting_->origin();
+  r.wall_time = clock::now() - start;
+  r.commands = usage.commands;
+  r.cpu_time = usage.cpu_time;
+  r.peak_rss = usage.peak_rss;
+  r.value = res.first;
+  r.interrupted = res.second;
+  usage += saved;
+  accounting_->record(r);
+  return res;
+}
+
+libbear::fitness_stream::
+fitness_stream(const fitness_function& ff, const population& p)
+  : ff_{ff}, remaining_{p.size()} {
+  // Known values are ready at once, without grouping.
+  std::vector<const genotype*> unknown{};
+  for (const auto& g : p) {
+    if (const auto f = ff_.known(g)) {
+      ready_.emplace_back(&g, *f);
+    } else {
+      unknown.push_back(&g);
+    }
+  }
+  start(unknown);
+}
+
+libbear::fitness_stream::
+fitness_stream(const fitness_function& ff,
+               const std::vector<const genotype*>& unknown)
+  : ff_{ff}, remaining_{unknown.size()} {
+  start(unknown);
+}
+
+void
+libbear::fitness_stream::
+start(const std::vector<const genotype*>& unknown) {
+  // Equal genotypes are calculated once.
+  std::unordered_map<const genotype*, std::size_t, pointee_hash, pointee_equal>
+    index{};
+  index.reserve(unknown.size());
+  for (const auto g : unknown) {
+    const auto [it, inserted] = index.emplace(g, groups_.size());
+    if (inserted) {
+      groups_.push_back({g});
+    } else {
+      groups_[it->second].push_back(g);
+    }
+  }
+  uncalculated_.resize(groups_.size());
+  std::iota(uncalculated_.begin(), uncalculated_.end(), std::size_t{0});
+  if (ff_.cost_) {
+    std::vector<double> costs{};
+    costs.reserve(groups_.size());
+    for (const auto& x : groups_) {
+      costs.push_back(ff_.cost_(*x.front()));
+    }
+    // Longest expected calculations first.
+    std::ranges::stable_sort(uncalculated_,
+                             [&costs](std::size_t a, std::size_t b) {
+                               return costs[a] > costs[b];
+                             });
   }
-  for (auto& x : v) {
-    fitness_values_->insert(x.get());
+  // Worker of the shared pool would wait here for other tasks of the pool.
+  if (fitness_function::thread_sz > 1 && uncalculated_.size() > 1
+      && !thread_pool::shared().is_worker()) {
+    multithreaded_calculations();
   }
-  DEBUG_MSG("Multithreaded calculations: end");
+}
+
+libbear::fitness_stream::
+~fitness_stream() {
+  cancelled_.store(true, std::memory_order_relaxed);
+  for (const auto& x : tasks_) {
+    x.wait();
+  }
+}
+
+std::optional<libbear::fitness_stream::value_type>
+libbear::fitness_stream::
+next() {
+  if (ready_.empty()) {
+    if (remaining_ == 0) {
+      return std::nullopt;
+    }
+    // Without pool, calculations are done here, one by one.
+    auto r = results_.try_pop();
+    const result x = r ? std::move(*r)
+      : !tasks_.empty() ? results_.pop()
+      : calculate(uncalculated_[next_uncalculated_++]);
+    if (x.error) {
+      std::rethrow_exception(x.error);
+    }
+    for (const auto g : groups_[x.group]) {
+      ready_.emplace_back(g, x.value);
+    }
+  }
+  const value_type res = ready_.back();
+  ready_.pop_back();
+  --remaining_;
+  return res;
+}
+
+libbear::fitness_stream::result
+libbear::fitness_stream::
+calculate(std::size_t i) const {
+  TRACE_SPAN("fitness calculation");
+  try {
+    return result{i, ff_.calculate(*groups_[i].front()), nullptr};
+  } catch (...) {
+    return result{i, incalculable, std::current_exception()};
+  }
+}
+
+void
+libbear::fitness_stream::
+multithreaded_calculations() {
+  TRACE_SPAN("multithreaded calculations");
+  DEBUG_MSG("Multithreaded calculations");
+  tasks_ = thread_pool::shared().async_for(
+    uncalculated_.size(), fitness_function::thread_sz, [this](std::size_t i) {
+      if (cancelled_.load(std::memory_order_relaxed)) {
+        return;
+      }
+      DEBUG_MSG("Asynchronous fitness calculations");
+      results_.push(calculate(uncalculated_[i]));
+    });
+}
+
+libbear::fitness_function::function
+libbear::evaluator_fitness(std::shared_ptr<evaluator_pool> ep) {
+  return [ep](const genotype& g) {
+    const std::string r{(*ep)(g.encode())};
+    char* end{};
+    const fitness res = std::strtod(r.c_str(), &end);
+    const bool number = end != r.c_str() && !std::isnan(res)
+      && std::all_of(static_cast<const char*>(end), r.c_str() + r.size(),
+                     [](unsigned char c) { return std::isspace(c); });
+    return number ? res : incalculable;
+  };
 }
 
 libbear::fitnesses
@@ -97,12 +320,18 @@ max(const population& p, const fitness_function& ff) {
   return max(ff(p));
 }
 
+libbear::fitness
+libbear::
+max(const evaluated_population& p) {
+  return max(fitness_values(p));
+}
+
 libbear::fitnesses
 libbear::
-max(const generations& gs, const fitness_function& ff) {
+max(const generations& gs) {
   fitnesses res{};
   std::ranges::transform(gs, std::back_inserter(res),
-                         [&ff](const population& p) { return max(p, ff); });
+                         [](const evaluated_population& p) { return max(p); });
   return res;
 }
 
@@ -119,25 +348,42 @@ min(const population& p, const fitness_function& ff) {
   return min(ff(p));
 }
 
+libbear::fitness
+libbear::
+min(const evaluated_population& p) {
+  return min(fitness_values(p));
+}
+
 libbear::fitnesses
 libbear::
-min(const generations& gs, const fitness_function& ff) {
+min(const generations& gs) {
   fitnesses res{};
   std::ranges::transform(gs, std::back_inserter(res),
-                         [&ff](const population& p) { return min(p, ff); });
+                         [](const evaluated_population& p) { return min(p); });
   return res;
 }
 
 libbear::selection_probabilities
 libbear::fitness_proportional_selection::
 operator()(const population& p) const {
+  return probabilities(ff_(p));
+}
+
+libbear::selection_probabilities
+libbear::fitness_proportional_selection::
+operator()(const evaluated_population& p) const {
+  return probabilities(fitness_values(p));
+}
+
+libbear::selection_probabilities
+libbear::fitness_proportional_selection::
+probabilities(const fitnesses& fs) {
   // FPS with windowing with workarounds for:
   // a) population of equally fit genotypes and
   // b) populations containing genotypes which fitnesses cannot be calculated
   // Please note that in b) case, there should be at least one genotype, which
   // fitness can be calculated.
   DEBUG_MSG("Fitness proportional selection");
-  const fitnesses fs{ff_(p)};
   const auto cal = select_calculable(fs, true);
   const fitness min = *std::ranges::min_element(cal);
   const auto n = cal.size();
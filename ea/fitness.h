@@ -1,14 +1,27 @@
 #ifndef LIBBEAR_EA_FITNESS_H
 #define LIBBEAR_EA_FITNESS_H
 
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <exception>
 #include <functional>
+#include <future>
 #include <limits>
-#include <map>
 #include <memory>
-#include <unordered_set>
+#include <optional>
+#include <stop_token>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <libbear/core/cache.h>
+#include <libbear/core/system.h>
+#include <libbear/core/thread.h>
+#include <libbear/ea/accounting.h>
 #include <libbear/ea/elements.h>
 #include <libbear/ea/genotype.h>
+#include <libbear/ea/individual.h>
+#include <libbear/ea/storage.h>
 
 namespace libbear {
 
@@ -18,12 +31,22 @@ namespace libbear {
     [](const genotype&) { return true; };
 
   // Fitness function adapted for time consuming fitness value calculations.
+  // Calculated values are kept in cache shared by all copies of the object.
+  // The cache is safe for concurrent use, so the object can be called from
+  // many threads at once.
+  // Optional storage makes them persistent between runs of the program: cache
+  // misses are looked up there before calculation and new values are written
+  // through to it.
   class fitness_function {
   private:
-    using unique_genotypes = std::unordered_set<genotype>;
+    using database = concurrent_cache<genotype, fitness>;
 
   public:
     using function = std::function<fitness(const genotype&)>;
+    // Expected relative time of fitness calculation.
+    using cost_function = std::function<double(const genotype&)>;
+    // Maximum number of workers of thread_pool::shared() calculating
+    // fitnesses of one population at once.
     static unsigned int thread_sz;
   
   private:
@@ -34,36 +57,159 @@ namespace libbear {
   public:
     explicit fitness_function(const function& f,
                               const genotype_constraints& gc =
-                                constraints_satisfied)
+                                constraints_satisfied,
+                              const cache_options& co = cache_options{},
+                              std::shared_ptr<fitness_storage> fs = nullptr)
       : function_{constrained_fitness_fn(f, gc)}
+      , fitness_values_{std::make_shared<database>(co,
+          [](const genotype& g, fitness) { return g.footprint(); })}
+      , storage_{std::move(fs)}
     {}
 
     fitness_function(const fitness_function&) = default;
     fitness_function& operator=(const fitness_function&) = default;
     fitness operator()(const genotype& g) const;
     fitnesses operator()(const population& p) const;
+    // Genotypes are paired with their fitnesses.
+    evaluated_population evaluate(population p) const;
     std::size_t size() const { return fitness_values_->size(); }
 
+    cache_statistics statistics() const
+    { return fitness_values_->statistics(); }
+
+    // Calculations of population are started in order of decreasing cost,
+    // which shortens the time of the whole batch if calculation times vary.
+    const cost_function& cost() const { return cost_; }
+    fitness_function& cost(const cost_function& c) { cost_ = c; return *this; }
+
+    // Fitness of genotypes which calculations were interrupted (function
+    // threw execution_interrupted, e.g. on timeout of external command),
+    // incalculable by default. It is not written to storage.
+    fitness interrupted() const { return interrupted_; }
+    fitness_function& interrupted(fitness f) { interrupted_ = f; return *this; }
+
+    // Limits of external commands run by function during calculation of one
+    // fitness: time (none if zero) and stop token. Calculation not started
+    // before stop request is interrupted too. Fitness of genotypes which
+    // commands failed (threw execution_failed) is incalculable.
+    std::chrono::milliseconds timeout() const { return timeout_; }
+
+    fitness_function& timeout(std::chrono::milliseconds t)
+    { timeout_ = t; return *this; }
+
+    const std::stop_token& stop() const { return stop_; }
+    fitness_function& stop(std::stop_token s) { stop_ = s; return *this; }
+
+    // Accounting of fitness values taken from cache or storage and of
+    // calculations, shared by copies of the object; none by default.
+    const std::shared_ptr<evaluation_accounting>& accounting() const
+    { return accounting_; }
+
+    fitness_function&
+    accounting(std::shared_ptr<evaluation_accounting> a)
+    { accounting_ = std::move(a); return *this; }
+
   private:
-    unique_genotypes uncalculated_fitness(const population& p) const;
-    void multithreaded_calculations(const population& p) const;
+    std::optional<fitness> known(const genotype& g) const;
+    fitness calculate(const genotype& g) const;
+    // Value of function and whether its calculation was interrupted.
+    std::pair<fitness, bool> invoke(const genotype& g) const;
+    std::pair<fitness, bool> accounted_invoke(const genotype& g) const;
+
+    friend class fitness_stream;
 
   private:
     function function_;
-    std::shared_ptr<std::unordered_map<genotype, fitness>> fitness_values_ =
-      std::make_shared<std::unordered_map<genotype, fitness>>();
+    std::shared_ptr<database> fitness_values_;
+    std::shared_ptr<fitness_storage> storage_;
+    cost_function cost_{};
+    fitness interrupted_{incalculable};
+    std::chrono::milliseconds timeout_{0};
+    std::stop_token stop_{};
+    std::shared_ptr<evaluation_accounting> accounting_{};
+  };
+
+  // Fitness values of population delivered one by one as soon as their
+  // calculations finish, so results can be used while the slowest
+  // calculations are still running. Values already known are delivered
+  // first. Pairs refer to elements of population, which has to outlive the
+  // stream. Destruction of the stream cancels calculations which have not
+  // started yet and waits for running ones.
+  class fitness_stream {
+  private:
+    // Genotypes of population are identified by pointers to its elements.
+    struct pointee_hash {
+      std::size_t operator()(const genotype* g) const { return g->hash(); }
+    };
+
+    struct pointee_equal {
+      bool operator()(const genotype* a, const genotype* b) const
+      { return *a == *b; }
+    };
+
+    // Index of group of equal genotypes with its fitness or exception thrown
+    // by fitness function.
+    struct result {
+      std::size_t group;
+      fitness value;
+      std::exception_ptr error;
+    };
+
+  public:
+    using value_type = std::pair<const genotype*, fitness>;
+
+    fitness_stream(const fitness_function& ff, const population& p);
+    fitness_stream(const fitness_stream&) = delete;
+    fitness_stream& operator=(const fitness_stream&) = delete;
+    ~fitness_stream();
+
+    // Number of pairs not delivered yet.
+    std::size_t remaining() const { return remaining_; }
+    // Waits for the next pair, std::nullopt means that all were delivered.
+    std::optional<value_type> next();
+
+  private:
+    // Genotypes which fitnesses are not known.
+    fitness_stream(const fitness_function& ff,
+                   const std::vector<const genotype*>& unknown);
+
+    void start(const std::vector<const genotype*>& unknown);
+    result calculate(std::size_t i) const;
+    void multithreaded_calculations();
+
+    friend class fitness_function;
+
+  private:
+    const fitness_function ff_;
+    std::vector<std::vector<const genotype*>> groups_{};
+    std::vector<std::size_t> uncalculated_{};
+    std::size_t next_uncalculated_{0};
+    std::vector<value_type> ready_{};
+    std::size_t remaining_;
+    completion_queue<result> results_{};
+    // Tasks calculating on thread_pool::shared().
+    std::vector<std::future<void>> tasks_{};
+    std::atomic_bool cancelled_{false};
   };
   
+  // Function of fitness calculated by external evaluators: request is
+  // genotype::encode() and response is fitness as decimal number. Response
+  // which is not a number means incalculable fitness.
+  fitness_function::function
+  evaluator_fitness(std::shared_ptr<evaluator_pool> ep);
+
   fitnesses select_calculable(const fitnesses& fs,
                               bool require_nonempty_result = false);
 
   fitness max(const fitnesses& fs);
   fitness max(const population& p, const fitness_function& ff);
-  fitnesses max(const generations& gs, const fitness_function& ff);
+  fitness max(const evaluated_population& p);
+  fitnesses max(const generations& gs);
 
   fitness min(const fitnesses& fs);
   fitness min(const population& p, const fitness_function& ff);
-  fitnesses min(const generations& gs, const fitness_function& ff);
+  fitness min(const evaluated_population& p);
+  fitnesses min(const generations& gs);
 
   class fitness_proportional_selection {
   public:
@@ -72,7 +218,11 @@ namespace libbear {
     {}
 
     selection_probabilities operator()(const population& p) const;
+    selection_probabilities operator()(const evaluated_population& p) const;
     
+  private:
+    static selection_probabilities probabilities(const fitnesses& fs);
+
   private:
     const fitness_function ff_;
   };
@@ -1,23 +1,157 @@
 #include <algorithm>
-#include <climits>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iterator>
 #include <iostream>
 #include <memory>
 #include <numeric>
-#include <libbear/core/memory.h>
+#include <string>
+#include <utility>
+#include <libbear/core/hash.h>
 #include <libbear/ea/genotype.h>
 
 libbear::genotype&
 libbear::genotype::
 operator=(const genotype& g) {
   if (&g != this) {
-    chain_ = deep_copy(g.chain_, [](const auto& x) { return x->clone(); });
+    chain_ = clone(*g.chain_);
+    hash_.store(g.hash_.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
   }
   return *this;
 }
 
+libbear::genotype&
+libbear::genotype::
+operator=(genotype&& g) noexcept {
+  if (&g != this) {
+    chain_ = std::exchange(g.chain_, empty());
+    hash_.store(g.hash_.exchange(0, std::memory_order_relaxed),
+                std::memory_order_relaxed);
+  }
+  return *this;
+}
+
+libbear::genotype::chain::
+chain(std::initializer_list<const_raw_pointer> gs) {
+  std::size_t sz{0};
+  for (const auto x : gs) {
+    sz += blocks(*x);
+  }
+  // Genes are built in local chain, which destroys them if clone throws.
+  chain res{};
+  res.buffer_.reset(new block[sz]);
+  res.capacity_ = sz;
+  res.genes_.reserve(gs.size());
+  for (const auto x : gs) {
+    res.push_back(*x);
+  }
+  swap(res);
+}
+
+libbear::genotype::chain::
+chain(const chain& c) {
+  chain res{};
+  res.buffer_.reset(new block[c.used_]);
+  res.capacity_ = c.used_;
+  res.genes_.reserve(c.genes_.size());
+  for (const auto x : c.genes_) {
+    res.push_back(*x);
+  }
+  swap(res);
+}
+
+libbear::genotype::chain::
+~chain() {
+  for (const auto x : genes_) {
+    x->~basic_gene();
+  }
+}
+
+std::size_t
+libbear::genotype::chain::
+footprint() const {
+  return capacity_ * sizeof(block) + genes_.capacity() * sizeof(raw_pointer);
+}
+
+void
+libbear::genotype::chain::
+push_back(const detail::basic_gene& g) {
+  const std::size_t sz = blocks(g);
+  if (used_ + sz > capacity_) {
+    chain c{};
+    c.capacity_ = std::max(2 * capacity_, used_ + sz);
+    c.buffer_.reset(new block[c.capacity_]);
+    c.genes_.reserve(std::max(genes_.capacity(), genes_.size() + 1));
+    for (const auto x : genes_) {
+      c.push_back(*x);
+    }
+    swap(c);
+  }
+  // Pointer is pushed after successful construction and cannot throw then.
+  if (genes_.size() == genes_.capacity()) {
+    genes_.reserve(std::max<std::size_t>(2 * genes_.capacity(), 1));
+  }
+  genes_.push_back(g.clone_into(buffer_.get() + used_));
+  used_ += sz;
+}
+
+std::size_t
+libbear::genotype::chain::
+blocks(const detail::basic_gene& g) {
+  return (g.footprint() + sizeof(block) - 1) / sizeof(block);
+}
+
+void
+libbear::genotype::chain::
+swap(chain& c) noexcept {
+  std::swap(buffer_, c.buffer_);
+  std::swap(capacity_, c.capacity_);
+  std::swap(used_, c.used_);
+  std::swap(genes_, c.genes_);
+}
+
+libbear::genotype
+libbear::genotype::
+share() const {
+  genotype res{};
+  res.chain_ = chain_;
+  res.hash_.store(hash_.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+  return res;
+}
+
+std::shared_ptr<libbear::genotype::chain>
+libbear::genotype::
+clone(const chain& c) {
+  return std::make_shared<chain>(c);
+}
+
+std::shared_ptr<libbear::genotype::chain>
+libbear::genotype::
+empty() noexcept {
+  // Shared by all empty genotypes, including moved-from ones. Any non-const
+  // access clones it first, so it is never modified.
+  static const std::shared_ptr<chain> res{std::make_shared<chain>()};
+  return res;
+}
+
+const std::shared_ptr<libbear::genotype::chain>&
+libbear::genotype::
+unique() {
+  hash_.store(0, std::memory_order_relaxed);
+  if (chain_.use_count() > 1) {
+    chain_ = clone(*chain_);
+  } else {
+    // Genotypes which shared the chain might have been read and destroyed
+    // on other threads; their reads happen before changes made here.
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+  return chain_;
+}
+
 bool
 libbear::genotype::
 operator==(const genotype& g) const {
@@ -53,13 +187,39 @@ operator<<(std::ostream& os, const genotype& g) {
 }
 
 std::size_t
-std::hash<libbear::genotype>::
-operator()(const libbear::genotype& g) const noexcept {
-  const std::size_t sz{sizeof(std::size_t) * CHAR_BIT};
-  std::size_t res{0};
-  for (std::size_t i = 0; const auto& x : g) {
-    res ^= x->hash() << i++ % sz;
+libbear::genotype::
+hash() const noexcept {
+  std::size_t res = hash_.load(std::memory_order_relaxed);
+  if (res == 0) {
+    hasher h{size()};
+    for (const auto x : chain_->genes()) {
+      h(x->hash());
+    }
+    res = std::max<std::size_t>(h.digest(), 1);
+    hash_.store(res, std::memory_order_relaxed);
   }
   return res;
 }
 
+std::size_t
+libbear::genotype::
+footprint() const {
+  return sizeof(chain) + chain_->footprint();
+}
+
+std::string
+libbear::genotype::
+encode() const {
+  std::string res{};
+  detail::encode_value<std::uint64_t>(res, size());
+  for (const auto x : chain_->genes()) {
+    x->encode(res);
+  }
+  return res;
+}
+
+std::size_t
+std::hash<libbear::genotype>::
+operator()(const libbear::genotype& g) const noexcept {
+  return g.hash();
+}
@@ -1,16 +1,25 @@
 #ifndef LIBBEAR_EA_GENOTYPE_H
 #define LIBBEAR_EA_GENOTYPE_H
 
+#include <atomic>
+#include <bit>
 #include <compare>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <initializer_list>
+#include <iomanip>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <new>
 #include <set>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <libbear/core/memory.h>
 #include <libbear/core/random.h>
 #include <libbear/core/range.h>
 
@@ -41,10 +50,17 @@ namespace libbear {
     class basic_gene : virtual basic_gene_restrictions {
     public:
       using ptr = std::unique_ptr<basic_gene>;
+      // Alignment of genes placed in buffers of genotypes.
+      static constexpr std::size_t alignment{
+        __STDCPP_DEFAULT_NEW_ALIGNMENT__
+      };
 
     public:
       virtual ~basic_gene() = default;
       virtual ptr clone() const = 0;
+      // Copy constructed in place, p has to be aligned to alignment and have
+      // room for footprint() bytes.
+      virtual basic_gene* clone_into(void* p) const = 0;
 
       template<typename T>
       T value() const {
@@ -68,6 +84,10 @@ namespace libbear {
 
       virtual basic_gene& random_reset() = 0;
       virtual std::size_t hash() const = 0;
+      // Size of dynamically allocated gene in bytes.
+      virtual std::size_t footprint() const = 0;
+      // Appends platform independent representation of value to string.
+      virtual void encode(std::string& s) const = 0;
 
       friend std::ostream& operator<<(std::ostream& os, const basic_gene& bg)
       { return bg.print(os); }
@@ -97,6 +117,38 @@ namespace libbear {
     bool operator==(const basic_gene&, const basic_gene&);
     std::partial_ordering operator<=>(const basic_gene&, const basic_gene&);
 
+    // Type tag followed by value: little-endian bytes for arithmetic types,
+    // length-prefixed text otherwise. Zero of either sign is encoded as +0.
+    template<typename T>
+    void encode_value(std::string& s, T t) {
+      if constexpr (std::is_arithmetic_v<T> && sizeof(T) <= 8
+                    && !std::is_same_v<T, long double>) {
+        using bits = std::conditional_t<
+          sizeof(T) == 1, std::uint8_t, std::conditional_t<
+            sizeof(T) == 2, std::uint16_t, std::conditional_t<
+              sizeof(T) == 4, std::uint32_t, std::uint64_t>>>;
+        static_assert(sizeof(T) == sizeof(bits));
+        if constexpr (std::is_floating_point_v<T>) {
+          t = t == T{0} ? T{0} : t;
+        }
+        s += std::is_same_v<T, bool> ? 'b'
+          : std::is_floating_point_v<T> ? 'f'
+          : std::is_signed_v<T> ? 'i' : 'u';
+        s += static_cast<char>(sizeof(T));
+        const auto b = std::bit_cast<bits>(t);
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+          s += static_cast<char>(b >> (8 * i));
+        }
+      } else {
+        std::ostringstream oss{};
+        oss << std::setprecision(std::numeric_limits<T>::max_digits10) << t;
+        const std::string str{oss.str()};
+        s += 't';
+        encode_value<std::uint64_t>(s, str.size());
+        s += str;
+      }
+    }
+
     template<typename T>
     class typed_gene : public basic_gene {
     public:
@@ -113,6 +165,11 @@ namespace libbear {
       base_ptr clone() const override
       { return std::make_unique<typed_gene>(*this); }
 
+      basic_gene* clone_into(void* p) const override {
+        static_assert(alignof(typed_gene) <= alignment);
+        return ::new (p) typed_gene(*this);
+      }
+
       T value() const { return value_; }
 
       virtual typed_gene& value(T t) {
@@ -128,6 +185,8 @@ namespace libbear {
       }
 
       std::size_t hash() const override { return std::hash<T>{}(value_); }
+      std::size_t footprint() const override { return sizeof(*this); }
+      void encode(std::string& s) const override { encode_value(s, value_); }
 
     protected:
       std::ostream& print(std::ostream& os) const override
@@ -177,7 +236,13 @@ namespace libbear {
     base_ptr clone() const override
     { return std::make_unique<gene>(*this); }
 
+    detail::basic_gene* clone_into(void* p) const override {
+      static_assert(alignof(gene) <= detail::basic_gene::alignment);
+      return ::new (p) gene(*this);
+    }
+
     range<T> constraints() const { return constraints_; }
+    std::size_t footprint() const override { return sizeof(*this); }
 
     gene& constraints(const range<T>& r) {
       if (!r.contains(this->value())) {
@@ -215,45 +280,110 @@ namespace libbear {
     range<T> constraints_;
   };
   
+  // Genes are placed one after another in single buffer, so copy of
+  // genotype costs the same three allocations regardless of number of genes.
   class genotype {
   public:
     using point = std::size_t;
     using crossover_points = std::set<point>;
-    using chain = std::vector<detail::basic_gene::ptr>;
-    using const_iterator = typename chain::const_iterator;
-    using iterator = typename chain::iterator;
     using raw_pointer = detail::basic_gene*;
-    
+    using const_raw_pointer = const detail::basic_gene*;
+    using const_iterator = std::vector<raw_pointer>::const_iterator;
+    using iterator = std::vector<raw_pointer>::iterator;
+
+  private:
+    class chain {
+    public:
+      chain() = default;
+      explicit chain(std::initializer_list<const_raw_pointer> gs);
+      chain(const chain& c);
+      chain& operator=(const chain&) = delete;
+      ~chain();
+
+      const std::vector<raw_pointer>& genes() const { return genes_; }
+      std::vector<raw_pointer>& genes() { return genes_; }
+      // Heap memory owned by chain in bytes.
+      std::size_t footprint() const;
+      // Copies of all the genes are moved to larger buffer if g does not fit.
+      void push_back(const detail::basic_gene& g);
+
+    private:
+      struct alignas(detail::basic_gene::alignment) block {
+        std::byte bytes[detail::basic_gene::alignment];
+      };
+
+      static std::size_t blocks(const detail::basic_gene& g);
+      void swap(chain& c) noexcept;
+
+    private:
+      std::unique_ptr<block[]> buffer_{};
+      std::size_t capacity_{0}; // blocks
+      std::size_t used_{0}; // blocks
+      std::vector<raw_pointer> genes_{};
+    };
+
   public:
     genotype() = default;
 
     template<typename... Ts>
     explicit(sizeof...(Ts) == 1) genotype(const gene<Ts>&... gs)
-      : chain_{make_vector_unique<detail::basic_gene>(gs...)}
+      : chain_{std::make_shared<chain>(
+          std::initializer_list<const_raw_pointer>{&gs...})}
     {}
 
     genotype(const genotype& g)
-      : chain_{deep_copy(g.chain_, [](const auto& x) { return x->clone(); })}
+      : chain_{clone(*g.chain_)}
+      , hash_{g.hash_.load(std::memory_order_relaxed)}
+    {}
+
+    genotype(genotype&& g) noexcept
+      : chain_{std::exchange(g.chain_, empty())}
+      , hash_{g.hash_.exchange(0, std::memory_order_relaxed)}
     {}
 
     genotype& operator=(const genotype& g);
-    std::size_t size() const { return chain_.size(); }
-    raw_pointer operator[](std::size_t i) const { return chain_[i].get(); }
-    raw_pointer at(std::size_t i) const { return chain_.at(i).get(); }
-    const_iterator begin() const { return chain_.begin(); }
-    const_iterator end() const { return chain_.end(); }
-    iterator begin() { return chain_.begin(); }
-    iterator end() { return chain_.end(); }
+    genotype& operator=(genotype&& g) noexcept;
+    // Copy sharing genes with this genotype until the first non-const access
+    // to either of them, which clones the genes first (copy-on-write). Used
+    // by selection, which copies the same parents many times. Raw pointers
+    // obtained by non-const access before must not be used afterwards.
+    genotype share() const;
+    std::size_t size() const { return chain_->genes().size(); }
+    const_raw_pointer operator[](std::size_t i) const
+    { return chain_->genes()[i]; }
+    raw_pointer operator[](std::size_t i) { return unique()->genes()[i]; }
+    const_raw_pointer at(std::size_t i) const
+    { return chain_->genes().at(i); }
+    raw_pointer at(std::size_t i) { return unique()->genes().at(i); }
+    const_iterator begin() const { return chain_->genes().cbegin(); }
+    const_iterator end() const { return chain_->genes().cend(); }
+    iterator begin() { return unique()->genes().begin(); }
+    iterator end() { return unique()->genes().end(); }
     bool operator==(const genotype& g) const;
+    // Calculated once and cached until next non-const access. Changes made
+    // through raw pointers obtained before hash() was called are not seen
+    // by the cache, so such pointers must not be kept across the call.
+    std::size_t hash() const noexcept;
+    // Heap memory owned by genotype in bytes (shared chain is also counted).
+    std::size_t footprint() const;
+    // Canonical representation of values, stable across runs and platforms.
+    std::string encode() const;
     genotype& random_reset();
     friend std::ostream& operator<<(std::ostream& os, const genotype& g);
     
+    // Raw pointers to genes obtained before are not valid any more.
     template<typename T>
-    void push_back(const gene<T>& g)
-    { chain_.push_back(std::make_unique<gene<T>>(g)); }
+    void push_back(const gene<T>& g) { unique()->push_back(g); }
     
   private:
-    chain chain_;
+    static std::shared_ptr<chain> clone(const chain& c);
+    static std::shared_ptr<chain> empty() noexcept;
+    const std::shared_ptr<chain>& unique();
+
+  private:
+    std::shared_ptr<chain> chain_{empty()};
+    // Zero stands for hash which is not calculated yet.
+    mutable std::atomic_size_t hash_{0};
   };
   
   std::ostream& operator<<(std::ostream&, const genotype&);
@@ -0,0 +1,22 @@
+#include <algorithm>
+#include <iterator>
+#include <libbear/ea/elements.h>
+#include <libbear/ea/genotype.h>
+#include <libbear/ea/individual.h>
+
+libbear::population
+libbear::genotypes(const evaluated_population& p) {
+  population res{};
+  res.reserve(p.size());
+  std::ranges::transform(p, std::back_inserter(res),
+                         [](const individual& x) { return x.g.share(); });
+  return res;
+}
+
+libbear::fitnesses
+libbear::fitness_values(const evaluated_population& p) {
+  fitnesses res{};
+  res.reserve(p.size());
+  std::ranges::transform(p, std::back_inserter(res), &individual::f);
+  return res;
+}
@@ -0,0 +1,27 @@
+#ifndef LIBBEAR_EA_INDIVIDUAL_H
+#define LIBBEAR_EA_INDIVIDUAL_H
+
+#include <functional>
+#include <vector>
+#include <libbear/ea/elements.h>
+#include <libbear/ea/genotype.h>
+
+namespace libbear {
+
+  // Genotype together with its fitness, which is calculated once, so that
+  // operators reading it do not look it up in fitness function cache again.
+  struct individual {
+    genotype g;
+    fitness f;
+  };
+
+  using evaluated_probabilities_fn =
+    std::function<selection_probabilities(const evaluated_population&)>;
+
+  // Genotypes of p, sharing their genes (see genotype::share).
+  population genotypes(const evaluated_population& p);
+  fitnesses fitness_values(const evaluated_population& p);
+
+} // namespace libbear
+
+#endif // LIBBEAR_EA_INDIVIDUAL_H
@@ -1,24 +1,140 @@
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <future>
 #include <iterator>
 #include <numeric>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 #include <libbear/core/debug.h>
 #include <libbear/core/random.h>
 #include <libbear/core/thread.h>
+#include <libbear/core/trace.h>
 #include <libbear/ea/elements.h>
+#include <libbear/ea/fitness.h>
 #include <libbear/ea/genotype.h>
+#include <libbear/ea/individual.h>
 #include <libbear/ea/population.h>
 
 namespace {
 
-  libbear::population
-  generate(std::size_t lambda, const std::function<libbear::genotype()>& f) {
-    libbear::population res{};
-    std::generate_n(std::back_inserter(res), lambda, f);
+  libbear::selection_probabilities
+  cumulative(libbear::selection_probabilities sp) {
+    std::partial_sum(sp.begin(), sp.end(), sp.begin());
+    // Last element should be exactly equal to 1. and another part of
+    // algorithm might require this exact identity. Unfortunately, numerical
+    // calculations might not be so precise. Let's check if last element is
+    // calculated with 1% precision (basic requirement):
+    assert(sp.back() > .99 && sp.back() < 1.01);
+    // Then, let's correct the value:
+    sp.back() = 1.;
+    return sp;
+  }
+
+  // Common part of population and evaluated population selections, sp are
+  // selection probabilities.
+  libbear::selection roulette_wheel(std::size_t lambda,
+                                    std::size_t n,
+                                    const libbear::selection_probabilities& sp) {
+    if (n != sp.size()) {
+      throw std::invalid_argument{"roulette_wheel_selection: bad size"};
+    }
+    return libbear::alias_table{sp}(lambda);
+  }
+
+  // c are cumulative probabilities.
+  libbear::selection
+  universal_sampling(std::size_t lambda,
+                     const libbear::selection_probabilities& c) {
+    auto r = libbear::random_from_uniform_distribution<double>(0., 1. / lambda);
+    libbear::selection res{};
+    res.reserve(lambda);
+    for (std::size_t i = 0, j = 0; j < lambda; ++i) {
+      for (; r <= c.at(i) && j < lambda; r += 1. / lambda, ++j) {
+        res.push_back(i);
+      }
+    }
+    std::shuffle(res.begin(), res.end(), libbear::random_engine());
+    return res;
+  }
+
+  // Selected genotypes are copied without copying their genes.
+  libbear::genotype shared_copy(const libbear::genotype& g)
+  { return g.share(); }
+
+  libbear::individual shared_copy(const libbear::individual& x)
+  { return libbear::individual{x.g.share(), x.f}; }
+
+  template<typename T>
+  std::vector<T> pick(const std::vector<T>& p, const libbear::selection& s) {
+    std::vector<T> res{};
+    res.reserve(s.size());
+    for (const auto i : s) {
+      res.push_back(shared_copy(p.at(i)));
+    }
+    return res;
+  }
+
+  // Strict order of indices of fitnesses fs: better fitness first, older (of
+  // smaller index) individuals win ties. Incalculable fitness is the lowest
+  // one, so it needs no special treatment.
+  struct better {
+    bool operator()(std::size_t a, std::size_t b) const
+    { return fs[a] > fs[b] || (fs[a] == fs[b] && a < b); }
+
+    const libbear::fitnesses& fs;
+  };
+
+  // Multiply-shift mapping of 32 random bits onto [0, n), see alias_table.
+  std::size_t uniform_index(libbear::random_engine_type& e, std::size_t n)
+  { return (std::uint64_t{e()} * n) >> 32; }
+
+  void check_nonempty(const char* name,
+                      std::size_t lambda,
+                      const libbear::fitnesses& fs) {
+    if (lambda != 0 && fs.empty()) {
+      throw std::invalid_argument{std::string{name} + ": empty population"};
+    }
+  }
+
+  // Indices of all fitnesses with the best sz of them in front, in order.
+  std::vector<std::size_t> ranking(std::size_t sz,
+                                   const libbear::fitnesses& fs) {
+    assert(sz <= fs.size());
+    std::vector<std::size_t> res(fs.size());
+    std::iota(res.begin(), res.end(), std::size_t{0});
+    std::ranges::nth_element(res, res.begin() + sz, better{fs});
+    std::sort(res.begin(), res.begin() + sz, better{fs});
+    return res;
+  }
+
+  // Indices of sz the best fitnesses in increasing order.
+  std::vector<std::size_t> best_indices(std::size_t sz,
+                                        const libbear::fitnesses& fs) {
+    assert(sz <= fs.size());
+    std::vector<std::size_t> res(fs.size());
+    std::iota(res.begin(), res.end(), std::size_t{0});
+    std::ranges::nth_element(res, res.begin() + sz, better{fs});
+    res.resize(sz);
+    std::ranges::sort(res);
+    return res;
+  }
+
+  template<typename T>
+  std::vector<T> merge_selected(const std::vector<std::size_t>& idx,
+                                const std::vector<T>& p0,
+                                const std::vector<T>& p1) {
+    std::vector<T> res{};
+    res.reserve(idx.size());
+    for (const auto i : idx) {
+      res.push_back(shared_copy(i < p0.size() ? p0[i] : p1[i - p0.size()]));
+    }
     return res;
   }
 
@@ -26,26 +142,62 @@ namespace {
 
 libbear::populate_2_fn
 libbear::adapter(const populate_1_fn& fn) {
-  return [=](std::size_t sz, const population& p0, const population& p1) {
-    population p{p0};
-    p.insert(p.end(), p1.begin(), p1.end());
-    return fn(sz, p);
+  // Arguments of populate_2_fn are passed by value, so individuals are
+  // moved into the merged population.
+  return [=](std::size_t sz, evaluated_population p0,
+             evaluated_population p1) {
+    p0.insert(p0.end(),
+              std::make_move_iterator(p1.begin()),
+              std::make_move_iterator(p1.end()));
+    return fn(sz, p0);
+  };
+}
+
+libbear::populate_1_fn
+libbear::materialize(const index_selection_fn& fn) {
+  return [=](std::size_t sz, const evaluated_population& p) {
+    return select(p, fn(sz, p));
   };
 }
 
+libbear::population
+libbear::
+select(const population& p, const selection& s) {
+  return pick(p, s);
+}
+
+libbear::evaluated_population
+libbear::
+select(const evaluated_population& p, const selection& s) {
+  return pick(p, s);
+}
+
+libbear::population
+libbear::
+share(const population& p) {
+  population res{};
+  res.reserve(p.size());
+  for (const auto& g : p) {
+    res.push_back(g.share());
+  }
+  return res;
+}
+
+libbear::evaluated_population
+libbear::
+share(const evaluated_population& p) {
+  evaluated_population res{};
+  res.reserve(p.size());
+  for (const auto& x : p) {
+    res.push_back(shared_copy(x));
+  }
+  return res;
+}
+
 libbear::selection_probabilities
 libbear::cumulative_probabilities(const selection_probabilities_fn& spf,
                                   const population& p) {
-  auto res = spf(p);
-  std::partial_sum(res.begin(), res.end(), res.begin());
-  // Last element should be exactly equal to 1. and another part of algorithm
-  // might require this exact identity. Unfortunately, numerical calculations
-  // might not be so precise. Let's check if last element is calculated with
-  // 1% precision (basic requirement):
-  assert(res.back() > .99 && res.back() < 1.01);
-  // Then, let's correct the value:
-  res.back() = 1.;
-  return res;
+  return cumulative(spf(p));
 }
 
 unsigned int
@@ -54,21 +206,38 @@ libbear::random_population::thread_sz = std::thread::hardware_concurrency();
 libbear::population
 libbear::random_population::
 operator()(std::size_t lambda) const {
+  TRACE_SPAN("random population");
   // Serial version generated bottleneck for some conditions.
-  using type = genotype;
-  thread_pool tp{thread_sz};
-  std::vector<std::future<type>> v{};
-  for (std::size_t i = 0; i < lambda; ++i) {
-    v.push_back(tp.async<type>(std::launch::async,
-                               [g = g_, this]() mutable -> type {
-                                 while(!constraints_(g.random_reset()));
-                                 DEBUG_MSG("Random genotype with constraints.");
-                                 return g;
-                               }));
+  if (lambda == 0) {
+    return population{};
+  }
+  // Every genotype is drawn from its own random stream, so the result does
+  // not depend on the number of threads nor on the order of execution.
+  const auto s = reserve_random_streams(lambda);
+  population res(lambda);
+  const auto create = [this, s, &res](std::size_t i) {
+    TRACE_SPAN("random genotype");
+    const random_stream rs{s + i};
+    genotype g{g_};
+    while(!constraints_(g.random_reset()));
+    DEBUG_MSG("Random genotype with constraints.");
+    res[i] = std::move(g);
+  };
+  auto& tp = thread_pool::shared();
+  if (thread_sz <= 1 || lambda == 1 || tp.is_worker()) {
+    for (std::size_t i = 0; i < lambda; ++i) {
+      create(i);
+    }
+    return res;
+  }
+  auto v = tp.async_for(lambda, thread_sz, create);
+  // All the tasks refer to res, so they are finished before any exception
+  // is thrown.
+  for (const auto& x : v) {
+    x.wait();
   }
-  population res{};
   for (auto& x : v) {
-    res.push_back(x.get());
+    x.get();
   }
   return res;
 }
@@ -76,32 +245,263 @@ operator()(std::size_t lambda) const {
 libbear::population
 libbear::roulette_wheel_selection::
 operator()(std::size_t lambda, const population& p) const {
-  const auto f =
-    [&,
-     c = cumulative_probabilities(spf_, p),
-     u = random_from_uniform_distribution<double>
-     ]() -> genotype {
-      return p.at(std::distance(c.begin(),
-                                std::lower_bound(c.begin(),
-                                                 c.end(),
-                                                 u(0., 1.))));
-    };
-  return generate(lambda, f);
+  return pick(p, indices(lambda, p));
+}
+
+libbear::evaluated_population
+libbear::roulette_wheel_selection::
+operator()(std::size_t lambda, const evaluated_population& p) const {
+  return pick(p, indices(lambda, p));
+}
+
+libbear::selection
+libbear::roulette_wheel_selection::
+indices(std::size_t lambda, const population& p) const {
+  return roulette_wheel(lambda, p.size(), spf_(p));
+}
+
+libbear::selection
+libbear::roulette_wheel_selection::
+indices(std::size_t lambda, const evaluated_population& p) const {
+  return roulette_wheel(lambda, p.size(),
+                        espf_ ? espf_(p) : spf_(genotypes(p)));
 }
 
 libbear::population
 libbear::stochastic_universal_sampling::
 operator()(std::size_t lambda, const population& p) const {
-  const auto a = cumulative_probabilities(spf_, p);
-  auto r = random_from_uniform_distribution<double>(0., 1. / lambda);
+  return pick(p, indices(lambda, p));
+}
 
-  population res{};
-  for (std::size_t i = 0, j = 0; j < lambda; ++i) {
-    for (; r <= a.at(i) && j < lambda; r += 1. / lambda, ++j) {
-      res.push_back(p.at(i));
+libbear::evaluated_population
+libbear::stochastic_universal_sampling::
+operator()(std::size_t lambda, const evaluated_population& p) const {
+  return pick(p, indices(lambda, p));
+}
+
+libbear::selection
+libbear::stochastic_universal_sampling::
+indices(std::size_t lambda, const population& p) const {
+  return universal_sampling(lambda, cumulative_probabilities(spf_, p));
+}
+
+libbear::selection
+libbear::stochastic_universal_sampling::
+indices(std::size_t lambda, const evaluated_population& p) const {
+  return universal_sampling(lambda,
+                            cumulative(espf_ ? espf_(p)
+                                             : spf_(genotypes(p))));
+}
+
+libbear::tournament_selection::
+tournament_selection(const fitness_function& ff, std::size_t k)
+  : ff_{ff}, k_{k} {
+  if (k == 0) {
+    throw std::invalid_argument{"tournament_selection: bad size"};
+  }
+}
+
+libbear::population
+libbear::tournament_selection::
+operator()(std::size_t lambda, const population& p) const {
+  return pick(p, indices(lambda, p));
+}
+
+libbear::evaluated_population
+libbear::tournament_selection::
+operator()(std::size_t lambda, const evaluated_population& p) const {
+  return pick(p, indices(lambda, p));
+}
+
+libbear::selection
+libbear::tournament_selection::
+indices(std::size_t lambda, const population& p) const {
+  return draw(lambda, ff_(p));
+}
+
+libbear::selection
+libbear::tournament_selection::
+indices(std::size_t lambda, const evaluated_population& p) const {
+  return draw(lambda, fitness_values(p));
+}
+
+libbear::selection
+libbear::tournament_selection::
+draw(std::size_t lambda, const fitnesses& fs) const {
+  check_nonempty("tournament_selection", lambda, fs);
+  const better b{fs};
+  auto& e = random_engine();
+  selection res(lambda);
+  for (auto& x : res) {
+    x = uniform_index(e, fs.size());
+    for (std::size_t i = 1; i < k_; ++i) {
+      if (const auto y = uniform_index(e, fs.size()); b(y, x)) {
+        x = y;
+      }
     }
   }
-  std::shuffle(res.begin(), res.end(), random_engine());
+  return res;
+}
+
+libbear::linear_ranking_selection::
+linear_ranking_selection(const fitness_function& ff, double pressure)
+  : ff_{ff}, pressure_{pressure} {
+  if (!(pressure >= 1. && pressure <= 2.)) {
+    throw std::invalid_argument{"linear_ranking_selection: bad pressure"};
+  }
+}
+
+libbear::population
+libbear::linear_ranking_selection::
+operator()(std::size_t lambda, const population& p) const {
+  return pick(p, indices(lambda, p));
+}
+
+libbear::evaluated_population
+libbear::linear_ranking_selection::
+operator()(std::size_t lambda, const evaluated_population& p) const {
+  return pick(p, indices(lambda, p));
+}
+
+libbear::selection
+libbear::linear_ranking_selection::
+indices(std::size_t lambda, const population& p) const {
+  return draw(lambda, ff_(p));
+}
+
+libbear::selection
+libbear::linear_ranking_selection::
+indices(std::size_t lambda, const evaluated_population& p) const {
+  return draw(lambda, fitness_values(p));
+}
+
+libbear::selection
+libbear::linear_ranking_selection::
+draw(std::size_t lambda, const fitnesses& fs) const {
+  check_nonempty("linear_ranking_selection", lambda, fs);
+  // Genotype of rank r (0 is the worst) wins binary tournament with
+  // replacement with probability (q (2r + 1) + (1 - q) (2(n - r) - 1)) / n^2,
+  // which is linear ranking of pressure 1 + (2q - 1) (n - 1) / n.
+  const double n = fs.size();
+  const double q = fs.size() == 1
+    ? 1. : std::min(1., (1. + (pressure_ - 1.) * n / (n - 1.)) / 2.);
+  const better b{fs};
+  auto& e = random_engine();
+  selection res(lambda);
+  for (auto& x : res) {
+    const auto i = uniform_index(e, fs.size());
+    const auto j = uniform_index(e, fs.size());
+    x = (detail::canonical<double>(e) < q) == b(i, j) ? i : j;
+  }
+  return res;
+}
+
+libbear::exponential_ranking_selection::
+exponential_ranking_selection(const fitness_function& ff, double base)
+  : ff_{ff}, base_{base} {
+  if (!(base > 0. && base < 1.)) {
+    throw std::invalid_argument{"exponential_ranking_selection: bad base"};
+  }
+}
+
+libbear::population
+libbear::exponential_ranking_selection::
+operator()(std::size_t lambda, const population& p) const {
+  return pick(p, indices(lambda, p));
+}
+
+libbear::evaluated_population
+libbear::exponential_ranking_selection::
+operator()(std::size_t lambda, const evaluated_population& p) const {
+  return pick(p, indices(lambda, p));
+}
+
+libbear::selection
+libbear::exponential_ranking_selection::
+indices(std::size_t lambda, const population& p) const {
+  return draw(lambda, ff_(p));
+}
+
+libbear::selection
+libbear::exponential_ranking_selection::
+indices(std::size_t lambda, const evaluated_population& p) const {
+  return draw(lambda, fitness_values(p));
+}
+
+libbear::selection
+libbear::exponential_ranking_selection::
+draw(std::size_t lambda, const fitnesses& fs) const {
+  check_nonempty("exponential_ranking_selection", lambda, fs);
+  if (lambda == 0) {
+    return selection{};
+  }
+  // Ranks from geometric distribution truncated to [0, n), by inversion.
+  const std::size_t n = fs.size();
+  const double tail = -std::expm1(n * std::log(base_)); // 1 - base^n
+  auto& e = random_engine();
+  selection res(lambda);
+  std::size_t worst{0};
+  for (auto& x : res) {
+    const double u = detail::canonical<double>(e);
+    x = std::min<std::size_t>(std::log1p(-u * tail) / std::log(base_), n - 1);
+    worst = std::max(worst, x);
+  }
+  const auto order = ranking(worst + 1, fs);
+  for (auto& x : res) {
+    x = order[x];
+  }
+  return res;
+}
+
+libbear::truncation_selection::
+truncation_selection(const fitness_function& ff, double ratio)
+  : ff_{ff}, ratio_{ratio} {
+  if (!(ratio > 0. && ratio <= 1.)) {
+    throw std::invalid_argument{"truncation_selection: bad ratio"};
+  }
+}
+
+libbear::population
+libbear::truncation_selection::
+operator()(std::size_t lambda, const population& p) const {
+  return pick(p, indices(lambda, p));
+}
+
+libbear::evaluated_population
+libbear::truncation_selection::
+operator()(std::size_t lambda, const evaluated_population& p) const {
+  return pick(p, indices(lambda, p));
+}
+
+libbear::selection
+libbear::truncation_selection::
+indices(std::size_t lambda, const population& p) const {
+  return draw(lambda, ff_(p));
+}
+
+libbear::selection
+libbear::truncation_selection::
+indices(std::size_t lambda, const evaluated_population& p) const {
+  return draw(lambda, fitness_values(p));
+}
+
+libbear::selection
+libbear::truncation_selection::
+draw(std::size_t lambda, const fitnesses& fs) const {
+  check_nonempty("truncation_selection", lambda, fs);
+  if (lambda == 0) {
+    return selection{};
+  }
+  const auto m = std::clamp<std::size_t>(std::ceil(ratio_ * fs.size()),
+                                         1, fs.size());
+  auto best = best_indices(m, fs);
+  // Parents left over by lambda not divisible by m are chosen at random.
+  std::ranges::shuffle(best, random_engine());
+  selection res(lambda);
+  for (std::size_t i = 0; i < lambda; ++i) {
+    res[i] = best[i % m];
+  }
+  std::ranges::shuffle(res, random_engine());
   return res;
 }
 
@@ -109,10 +509,70 @@ libbear::population
 libbear::
 generational_survivor_selection(std::size_t sz,
                                 const population& generation,
-                                const population& offspring) {
+                                population offspring) {
   if (generation.size() != sz || offspring.size() != sz) {
     throw std::invalid_argument{"generational_survivor_selection: bad size"};
   }
   return offspring;
 }
 
+libbear::evaluated_population
+libbear::
+generational_survivor_selection(std::size_t sz,
+                                const evaluated_population& generation,
+                                evaluated_population offspring) {
+  if (generation.size() != sz || offspring.size() != sz) {
+    throw std::invalid_argument{"generational_survivor_selection: bad size"};
+  }
+  return offspring;
+}
+
+libbear::population
+libbear::replace_worst_survivor_selection::
+operator()(std::size_t sz,
+           const population& generation,
+           const population& offspring) const {
+  fitnesses fs{ff_(generation)};
+  const fitnesses fo{ff_(offspring)};
+  fs.insert(fs.end(), fo.begin(), fo.end());
+  if (sz > fs.size()) {
+    throw std::invalid_argument{"replace_worst_survivor_selection: bad size"};
+  }
+  return merge_selected(best_indices(sz, fs), generation, offspring);
+}
+
+libbear::evaluated_population
+libbear::replace_worst_survivor_selection::
+operator()(std::size_t sz,
+           const evaluated_population& generation,
+           const evaluated_population& offspring) const {
+  fitnesses fs{fitness_values(generation)};
+  const fitnesses fo{fitness_values(offspring)};
+  fs.insert(fs.end(), fo.begin(), fo.end());
+  if (sz > fs.size()) {
+    throw std::invalid_argument{"replace_worst_survivor_selection: bad size"};
+  }
+  return merge_selected(best_indices(sz, fs), generation, offspring);
+}
+
+libbear::population
+libbear::comma_survivor_selection::
+operator()(std::size_t sz,
+           const population&,
+           const population& offspring) const {
+  if (sz > offspring.size()) {
+    throw std::invalid_argument{"comma_survivor_selection: bad size"};
+  }
+  return pick(offspring, best_indices(sz, ff_(offspring)));
+}
+
+libbear::evaluated_population
+libbear::comma_survivor_selection::
+operator()(std::size_t sz,
+           const evaluated_population&,
+           const evaluated_population& offspring) const {
+  if (sz > offspring.size()) {
+    throw std::invalid_argument{"comma_survivor_selection: bad size"};
+  }
+  return pick(offspring, best_indices(sz, fitness_values(offspring)));
+}
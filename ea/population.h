@@ -1,14 +1,26 @@
 #ifndef LIBBEAR_EA_POPULATION_H
 #define LIBBEAR_EA_POPULATION_H
 
+#include <cstddef>
 #include <functional>
 #include <libbear/ea/elements.h>
 #include <libbear/ea/fitness.h>
 #include <libbear/ea/genotype.h>
+#include <libbear/ea/individual.h>
 
 namespace libbear {
 
   populate_2_fn adapter(const populate_1_fn& fn);
+  populate_1_fn materialize(const index_selection_fn& fn);
+
+  // Copies of selected genotypes, sharing genes with p (see
+  // genotype::share).
+  population select(const population& p, const selection& s);
+  evaluated_population select(const evaluated_population& p,
+                              const selection& s);
+  // Copies of all genotypes of p sharing their genes.
+  population share(const population& p);
+  evaluated_population share(const evaluated_population& p);
 
   selection_probabilities
   cumulative_probabilities(const selection_probabilities_fn& spf,
@@ -16,6 +28,7 @@ namespace libbear {
 
   class random_population {
   public:
+    // Maximum number of workers of thread_pool::shared() used at once.
     static unsigned int thread_sz;
 
   public:
@@ -32,34 +45,213 @@ namespace libbear {
     const genotype_constraints constraints_;
   };
 
+  // Selection operators below accept also evaluated populations. Their
+  // probabilities are then taken from espf, or from spf applied to
+  // genotypes, if espf is not given.
   class roulette_wheel_selection {
   public:
-    explicit roulette_wheel_selection(const selection_probabilities_fn& spf)
-      : spf_{spf}
+    explicit roulette_wheel_selection(const selection_probabilities_fn& spf,
+                                      const evaluated_probabilities_fn& espf =
+                                        nullptr)
+      : spf_{spf}, espf_{espf}
+    {}
+
+    explicit
+    roulette_wheel_selection(const fitness_proportional_selection& fps)
+      : roulette_wheel_selection{fps, fps}
     {}
 
     population operator()(std::size_t lambda, const population& p) const;
+    evaluated_population operator()(std::size_t lambda,
+                                    const evaluated_population& p) const;
+    selection indices(std::size_t lambda, const population& p) const;
+    selection indices(std::size_t lambda,
+                      const evaluated_population& p) const;
 
   private:
     const selection_probabilities_fn  spf_;
+    const evaluated_probabilities_fn espf_;
   };
 
   class stochastic_universal_sampling {
   public:
     explicit
-    stochastic_universal_sampling(const selection_probabilities_fn& spf)
-      : spf_{spf}
+    stochastic_universal_sampling(const selection_probabilities_fn& spf,
+                                  const evaluated_probabilities_fn& espf =
+                                    nullptr)
+      : spf_{spf}, espf_{espf}
+    {}
+
+    explicit
+    stochastic_universal_sampling(const fitness_proportional_selection& fps)
+      : stochastic_universal_sampling{fps, fps}
     {}
 
     population operator()(std::size_t lambda, const population& p) const;
+    evaluated_population operator()(std::size_t lambda,
+                                    const evaluated_population& p) const;
+    selection indices(std::size_t lambda, const population& p) const;
+    selection indices(std::size_t lambda,
+                      const evaluated_population& p) const;
 
   private:
     const selection_probabilities_fn spf_;
+    const evaluated_probabilities_fn espf_;
   };
 
+  // Selection operators below compare fitness values only, so they need
+  // neither selection probabilities nor their prefix sums. Incalculable
+  // fitness is the worst one and ties are won by smaller index.
+
+  // Every parent is the best of k genotypes drawn with replacement, which
+  // costs O(lambda k).
+  class tournament_selection {
+  public:
+    tournament_selection(const fitness_function& ff, std::size_t k);
+
+    population operator()(std::size_t lambda, const population& p) const;
+    evaluated_population operator()(std::size_t lambda,
+                                    const evaluated_population& p) const;
+    selection indices(std::size_t lambda, const population& p) const;
+    selection indices(std::size_t lambda,
+                      const evaluated_population& p) const;
+
+  private:
+    selection draw(std::size_t lambda, const fitnesses& fs) const;
+
+  private:
+    const fitness_function ff_;
+    const std::size_t k_;
+  };
+
+  // Linear ranking of selective pressure s from [1, 2]: the best genotype is
+  // selected with probability s / n, the worst one with (2 - s) / n. Every
+  // draw is a binary tournament won by the better genotype with probability
+  // adjusted to s, so no ranking is computed. Pressure above 2 - 1 / n acts
+  // as 2 - 1 / n.
+  class linear_ranking_selection {
+  public:
+    linear_ranking_selection(const fitness_function& ff, double pressure);
+
+    population operator()(std::size_t lambda, const population& p) const;
+    evaluated_population operator()(std::size_t lambda,
+                                    const evaluated_population& p) const;
+    selection indices(std::size_t lambda, const population& p) const;
+    selection indices(std::size_t lambda,
+                      const evaluated_population& p) const;
+
+  private:
+    selection draw(std::size_t lambda, const fitnesses& fs) const;
+
+  private:
+    const fitness_function ff_;
+    const double pressure_;
+  };
+
+  // Exponential ranking: probability of selection of the k-th best genotype
+  // is proportional to base^k, base from (0, 1). Ranks are drawn first, so
+  // only the best genotypes up to the worst rank drawn are sorted.
+  class exponential_ranking_selection {
+  public:
+    exponential_ranking_selection(const fitness_function& ff, double base);
+
+    population operator()(std::size_t lambda, const population& p) const;
+    evaluated_population operator()(std::size_t lambda,
+                                    const evaluated_population& p) const;
+    selection indices(std::size_t lambda, const population& p) const;
+    selection indices(std::size_t lambda,
+                      const evaluated_population& p) const;
+
+  private:
+    selection draw(std::size_t lambda, const fitnesses& fs) const;
+
+  private:
+    const fitness_function ff_;
+    const double base_;
+  };
+
+  // The best ceil(ratio n) genotypes, ratio from (0, 1], become parents
+  // equally often. They are found with partition in O(n).
+  class truncation_selection {
+  public:
+    truncation_selection(const fitness_function& ff, double ratio);
+
+    population operator()(std::size_t lambda, const population& p) const;
+    evaluated_population operator()(std::size_t lambda,
+                                    const evaluated_population& p) const;
+    selection indices(std::size_t lambda, const population& p) const;
+    selection indices(std::size_t lambda,
+                      const evaluated_population& p) const;
+
+  private:
+    selection draw(std::size_t lambda, const fitnesses& fs) const;
+
+  private:
+    const fitness_function ff_;
+    const double ratio_;
+  };
+
+  // Index selection made of selection operator s, which provides indices().
+  template<typename S>
+  index_selection_fn index_selection(const S& s) {
+    return [s](std::size_t lambda, const evaluated_population& p) {
+      return s.indices(lambda, p);
+    };
+  }
+
+  // Offspring is taken by value, so that it is moved, not copied, when
+  // passed as rvalue (e.g. through populate_2_fn).
   population generational_survivor_selection(std::size_t sz,
                                              const population& generation,
-                                             const population& offspring);
+                                             population offspring);
+
+  evaluated_population
+  generational_survivor_selection(std::size_t sz,
+                                  const evaluated_population& generation,
+                                  evaluated_population offspring);
+
+  // Offspring replace the worst individuals, if they are better than them.
+  // Suitable for steady-state evolution.
+  class replace_worst_survivor_selection {
+  public:
+    explicit replace_worst_survivor_selection(const fitness_function& ff)
+      : ff_{ff}
+    {}
+
+    population operator()(std::size_t sz,
+                          const population& generation,
+                          const population& offspring) const;
+    evaluated_population operator()(std::size_t sz,
+                                    const evaluated_population& generation,
+                                    const evaluated_population& offspring)
+      const;
+
+  private:
+    const fitness_function ff_;
+  };
+
+  // (mu + lambda) selection: the best of generation and offspring survive.
+  using plus_survivor_selection = replace_worst_survivor_selection;
+
+  // (mu, lambda) selection: the best of offspring survive, generation is
+  // discarded. Offspring must not be smaller than generation.
+  class comma_survivor_selection {
+  public:
+    explicit comma_survivor_selection(const fitness_function& ff)
+      : ff_{ff}
+    {}
+
+    population operator()(std::size_t sz,
+                          const population& generation,
+                          const population& offspring) const;
+    evaluated_population operator()(std::size_t sz,
+                                    const evaluated_population& generation,
+                                    const evaluated_population& offspring)
+      const;
+
+  private:
+    const fitness_function ff_;
+  };
 
 } // namespace libbear
 
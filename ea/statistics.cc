@@ -0,0 +1,112 @@
+#include <cstddef>
+#include <stdexcept>
+#include <unordered_set>
+#include <libbear/ea/elements.h>
+#include <libbear/ea/fitness.h>
+#include <libbear/ea/genotype.h>
+#include <libbear/ea/individual.h>
+#include <libbear/ea/statistics.h>
+
+namespace {
+
+  // Distinct genotypes are counted without copying them.
+  class distinct_counter {
+  private:
+    struct pointee_hash {
+      std::size_t operator()(const libbear::genotype* g) const
+      { return g->hash(); }
+    };
+
+    struct pointee_equal {
+      bool operator()(const libbear::genotype* a,
+                      const libbear::genotype* b) const
+      { return *a == *b; }
+    };
+
+  public:
+    void insert(const libbear::genotype& g) { set_.insert(&g); }
+    std::size_t size() const { return set_.size(); }
+
+  private:
+    std::unordered_set<const libbear::genotype*, pointee_hash, pointee_equal>
+      set_{};
+  };
+
+}
+
+void
+libbear::run_statistics::
+update(const population& p) {
+  update(p, ff_(p));
+}
+
+void
+libbear::run_statistics::
+update(const population& p, const fitnesses& fs) {
+  if (p.size() != fs.size()) {
+    throw std::invalid_argument{"run_statistics: size mismatch"};
+  }
+  distinct_counter dc{};
+  for (const auto& g : p) {
+    dc.insert(g);
+  }
+  update(fs, dc.size());
+}
+
+void
+libbear::run_statistics::
+update(const evaluated_population& p) {
+  distinct_counter dc{};
+  for (const auto& x : p) {
+    dc.insert(x.g);
+  }
+  update(fitness_values(p), dc.size());
+}
+
+void
+libbear::run_statistics::
+update(const fitnesses& fs, std::size_t distinct) {
+  generation_statistics res{};
+  res.size = fs.size();
+  // Welford's algorithm.
+  fitness mean{0.};
+  fitness m2{0.};
+  for (const auto f : fs) {
+    if (f == incalculable) {
+      continue;
+    }
+    const fitness delta = f - mean;
+    mean += delta / ++res.calculable;
+    m2 += delta * (f - mean);
+    if (res.calculable == 1 || f > res.best) {
+      res.best = f;
+    }
+    if (res.calculable == 1 || f < res.worst) {
+      res.worst = f;
+    }
+  }
+  if (res.calculable != 0) {
+    res.mean = mean;
+    res.variance = m2 / res.calculable;
+  }
+  res.diversity = fs.empty() ? 0. : double(distinct) / fs.size();
+  if (res.calculable != 0) {
+    if (best_ == incalculable || res.best > best_) {
+      best_ = res.best;
+      best_generation_ = history_.size();
+    }
+    if (worst_best_ == incalculable || res.best < worst_best_) {
+      worst_best_ = res.best;
+    }
+  }
+  history_.push_back(res);
+}
+
+void
+libbear::run_statistics::
+clear() {
+  history_.clear();
+  best_ = incalculable;
+  worst_best_ = incalculable;
+  best_generation_ = 0;
+}
@@ -0,0 +1,64 @@
+#ifndef LIBBEAR_EA_STATISTICS_H
+#define LIBBEAR_EA_STATISTICS_H
+
+#include <cstddef>
+#include <vector>
+#include <libbear/ea/elements.h>
+#include <libbear/ea/fitness.h>
+#include <libbear/ea/individual.h>
+
+namespace libbear {
+
+  // Summary of one generation. Fitness statistics take into account only
+  // calculable values, they are equal to incalculable if there are none.
+  struct generation_statistics {
+    std::size_t size{0};
+    std::size_t calculable{0};
+    fitness best{incalculable};
+    fitness worst{incalculable};
+    fitness mean{incalculable};
+    fitness variance{0.};
+    // Fraction of distinct genotypes in population.
+    double diversity{0.};
+  };
+
+  // Statistics of evolution updated incrementally, once per generation, so
+  // that questions about the whole run (e.g. by termination conditions) cost
+  // O(1) instead of the pass over all the generations.
+  class run_statistics {
+  public:
+    explicit run_statistics(const fitness_function& ff) : ff_{ff} {}
+
+    void update(const population& p);
+    // For fitnesses already calculated.
+    void update(const population& p, const fitnesses& fs);
+    void update(const evaluated_population& p);
+    void clear();
+
+    // Number of generations seen.
+    std::size_t size() const { return history_.size(); }
+    const std::vector<generation_statistics>& history() const
+    { return history_; }
+    const generation_statistics& last() const { return history_.back(); }
+
+    // The best and the worst of the best fitnesses of generations.
+    fitness best() const { return best_; }
+    fitness worst_best() const { return worst_best_; }
+    // Generations since the best fitness was improved last time.
+    std::size_t stagnation() const
+    { return history_.size() - 1 - best_generation_; }
+
+  private:
+    void update(const fitnesses& fs, std::size_t distinct);
+
+  private:
+    fitness_function ff_;
+    std::vector<generation_statistics> history_{};
+    fitness best_{incalculable};
+    fitness worst_best_{incalculable};
+    std::size_t best_generation_{0};
+  };
+
+} // namespace libbear
+
+#endif // LIBBEAR_EA_STATISTICS_H
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <libbear/core/hash.h>
+#include <libbear/ea/elements.h>
+#include <libbear/ea/storage.h>
+
+namespace {
+
+  // File layout: magic, then records of the form
+  //   key length (u32) | key | fitness (f64) | checksum (u64),
+  // all numbers little-endian.
+  const std::string_view magic{"LIBBEAR-FITNESS-1\n"};
+
+  void put(std::string& s, std::uint64_t x, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      s += static_cast<char>(x >> (8 * i));
+    }
+  }
+
+  std::uint64_t get(const char* p, std::size_t n) {
+    std::uint64_t res{0};
+    for (std::size_t i = 0; i < n; ++i) {
+      res |= std::uint64_t{static_cast<unsigned char>(p[i])} << (8 * i);
+    }
+    return res;
+  }
+
+  std::uint64_t checksum(std::string_view key, std::uint64_t f) {
+    libbear::hasher h{key.size()};
+    for (std::size_t i = 0; i < key.size(); i += 8) {
+      h(get(key.data() + i, std::min<std::size_t>(8, key.size() - i)));
+    }
+    return h(f).digest();
+  }
+
+  std::string record(std::string_view key, libbear::fitness f) {
+    const auto bits = std::bit_cast<std::uint64_t>(f);
+    std::string res{};
+    put(res, key.size(), 4);
+    res += key;
+    put(res, bits, 8);
+    put(res, checksum(key, bits), 8);
+    return res;
+  }
+
+  [[noreturn]] void fail(const std::string& what) {
+    throw std::system_error{errno, std::generic_category(),
+                            "fitness_storage: " + what};
+  }
+
+  void write_all(int fd, std::string_view s) {
+    while (!s.empty()) {
+      const auto n = ::write(fd, s.data(), s.size());
+      if (n < 0 && errno != EINTR) {
+        fail("write");
+      }
+      s.remove_prefix(n < 0 ? 0 : n);
+    }
+  }
+
+}
+
+libbear::fitness_storage::
+fitness_storage(const std::string& filename, bool synchronous)
+  : filename_{filename}
+  , synchronous_{synchronous}
+  , fd_{::open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC,
+               0644)} {
+  if (fd_ < 0) {
+    fail("cannot open " + filename);
+  }
+  try {
+    load();
+  } catch (...) {
+    ::close(fd_);
+    throw;
+  }
+}
+
+libbear::fitness_storage::
+~fitness_storage() {
+  ::close(fd_);
+}
+
+std::optional<libbear::fitness>
+libbear::fitness_storage::
+find(const std::string& key) const {
+  std::lock_guard<std::mutex> lg{index_m_};
+  const auto it = index_.find(key);
+  return it == index_.end() ? std::nullopt : std::optional{it->second};
+}
+
+void
+libbear::fitness_storage::
+insert(const std::string& key, fitness f) {
+  // Index is not locked during write and fdatasync, so find is not blocked
+  // by the disk.
+  std::lock_guard<std::mutex> lg{write_m_};
+  if (std::lock_guard<std::mutex> ilg{index_m_}; index_.contains(key)) {
+    return;
+  }
+  // Single write of whole record with O_APPEND: records of concurrent
+  // writers are not interleaved. Partial record of failed write is left in
+  // place and skipped by load, as other processes may have appended their
+  // records after it.
+  write_all(fd_, record(key, f));
+  if (synchronous_ && ::fdatasync(fd_) != 0) {
+    fail("fdatasync");
+  }
+  std::lock_guard<std::mutex> ilg{index_m_};
+  index_.emplace(key, f);
+}
+
+std::size_t
+libbear::fitness_storage::
+size() const {
+  std::lock_guard<std::mutex> lg{index_m_};
+  return index_.size();
+}
+
+void
+libbear::fitness_storage::
+load() {
+  struct stat st{};
+  if (::fstat(fd_, &st) != 0) {
+    fail("fstat");
+  }
+  const auto sz = static_cast<std::size_t>(st.st_size);
+  if (sz < magic.size()) {
+    // File is new or creation was interrupted while writing magic.
+    std::string head(sz, '\0');
+    if (::pread(fd_, head.data(), sz, 0) != static_cast<ssize_t>(sz)) {
+      fail("pread");
+    }
+    if (!magic.starts_with(head)) {
+      throw std::runtime_error{"fitness_storage: bad file " + filename_};
+    }
+    if (sz != 0 && ::ftruncate(fd_, 0) != 0) {
+      fail("ftruncate");
+    }
+    write_all(fd_, magic);
+    return;
+  }
+  void* addr = ::mmap(nullptr, sz, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (addr == MAP_FAILED) {
+    fail("mmap");
+  }
+  const char* const data = static_cast<const char*>(addr);
+  if (std::string_view{data, magic.size()} != magic) {
+    ::munmap(addr, sz);
+    throw std::runtime_error{"fitness_storage: bad file " + filename_};
+  }
+  // Bytes which do not start a valid record are remnants of interrupted
+  // writes, possibly followed by records appended later, so they are
+  // skipped one by one and nothing is cut off.
+  for (std::size_t pos = magic.size(); sz - pos >= 20;) {
+    const std::size_t n = get(data + pos, 4);
+    if (sz - pos - 20 >= n) {
+      const std::string_view key{data + pos + 4, n};
+      const std::uint64_t bits = get(data + pos + 4 + n, 8);
+      if (get(data + pos + 12 + n, 8) == checksum(key, bits)) {
+        index_.emplace(key, std::bit_cast<fitness>(bits));
+        pos += 20 + n;
+        continue;
+      }
+    }
+    ++pos;
+  }
+  ::munmap(addr, sz);
+}
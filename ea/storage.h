@@ -0,0 +1,48 @@
+#ifndef LIBBEAR_EA_STORAGE_H
+#define LIBBEAR_EA_STORAGE_H
+
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <libbear/ea/elements.h>
+
+namespace libbear {
+
+  // Persistent memoization of fitness values keyed by canonical genotype
+  // encoding (see genotype::encode). Values are appended to log file as
+  // records protected by checksums. Torn record left by a crash is skipped
+  // at next opening, together with any other bytes which do not form a valid
+  // record; records after it are still read. Whole log is read through mmap
+  // and indexed in memory when storage is opened.
+  class fitness_storage {
+  public:
+    // With synchronous == true every record is flushed to the disk before
+    // insert returns.
+    explicit fitness_storage(const std::string& filename,
+                             bool synchronous = true);
+    fitness_storage(const fitness_storage&) = delete;
+    fitness_storage& operator=(const fitness_storage&) = delete;
+    ~fitness_storage();
+
+    std::optional<fitness> find(const std::string& key) const;
+    // Records already present in storage are not written again.
+    void insert(const std::string& key, fitness f);
+    std::size_t size() const;
+
+  private:
+    void load();
+
+  private:
+    const std::string filename_;
+    const bool synchronous_;
+    int fd_;
+    std::mutex write_m_{};
+    mutable std::mutex index_m_{};
+    std::unordered_map<std::string, fitness> index_{};
+  };
+
+} // namespace libbear
+
+#endif // LIBBEAR_EA_STORAGE_H
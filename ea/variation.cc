@@ -1,7 +1,10 @@
 #include <stdexcept>
+#include <utility>
 #include <libbear/core/debug.h>
+#include <libbear/core/trace.h>
 #include <libbear/ea/elements.h>
 #include <libbear/ea/genotype.h>
+#include <libbear/ea/individual.h>
 #include <libbear/ea/variation.h>
 
 libbear::population
@@ -32,7 +35,7 @@ operator()(const genotype& g0, const genotype& g1) const {
   DEBUG_MSG("Recombination: " << g0 << " + " << g1);
   for (const auto& g : recombine_(g0, g1)) {
     DEBUG_MSG("Mutation: " << g);
-    res.push_back(mutate_(g).at(0));
+    res.push_back(std::move(mutate_(g).at(0)));
   }
   assert(res.size() == 1 || res.size() == 2);
   return res;
@@ -41,16 +44,52 @@ operator()(const genotype& g0, const genotype& g1) const {
 libbear::population
 libbear::variation::
 operator()(const population& p) const {
+  TRACE_SPAN("variation");
   if (p.size() % 2) {
     throw std::invalid_argument{"variation: wrong population size"};
   }
   population res;
   for (std::size_t i = 0; i < p.size(); i += 2) {
-    for (const auto& g : operator()(p[i], p[i + 1])) {
-      res.push_back(g);
+    for (auto& g : operator()(p[i], p[i + 1])) {
+      res.push_back(std::move(g));
     }
   }
   assert(res.size() == p.size() / 2 || res.size() == p.size());
   return res;
 }
 
+libbear::population
+libbear::variation::
+operator()(const population& p, const selection& s) const {
+  TRACE_SPAN("variation");
+  if (s.size() % 2) {
+    throw std::invalid_argument{"variation: wrong selection size"};
+  }
+  population res;
+  res.reserve(s.size());
+  for (std::size_t i = 0; i < s.size(); i += 2) {
+    for (auto& g : operator()(p.at(s[i]), p.at(s[i + 1]))) {
+      res.push_back(std::move(g));
+    }
+  }
+  assert(res.size() == s.size() / 2 || res.size() == s.size());
+  return res;
+}
+
+libbear::population
+libbear::variation::
+operator()(const evaluated_population& p, const selection& s) const {
+  TRACE_SPAN("variation");
+  if (s.size() % 2) {
+    throw std::invalid_argument{"variation: wrong selection size"};
+  }
+  population res;
+  res.reserve(s.size());
+  for (std::size_t i = 0; i < s.size(); i += 2) {
+    for (auto& g : operator()(p.at(s[i]).g, p.at(s[i + 1]).g)) {
+      res.push_back(std::move(g));
+    }
+  }
+  assert(res.size() == s.size() / 2 || res.size() == s.size());
+  return res;
+}
@@ -7,9 +7,12 @@
 #include <stdexcept>
 #include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
 #include <libbear/core/random.h>
 #include <libbear/ea/elements.h>
 #include <libbear/ea/genotype.h>
+#include <libbear/ea/individual.h>
 
 namespace libbear {
   
@@ -64,6 +67,10 @@ namespace libbear {
 
     population operator()(const genotype& g0, const genotype& g1) const;
     population operator()(const population& p) const;
+    // Parents are given by indices of genotypes in p.
+    population operator()(const population& p, const selection& s) const;
+    population operator()(const evaluated_population& p,
+                          const selection& s) const;
     
   private:
     const mutation_fn mutate_;
@@ -85,7 +92,7 @@ namespace libbear {
         , length_{std::get<2>(arg)}
       {}
 
-      void operator()(const genotype& g) const {
+      void operator()(genotype& g) const {
         if (g.size() < start_ + length_) {
           throw
             std::logic_error{"iterative_mutation_on_range: size mismatch"};
@@ -116,7 +123,7 @@ namespace libbear {
         , length_{std::get<2>(arg)}
       {}
 
-      void operator()(const genotype& g0, const genotype& g1) const {
+      void operator()(genotype& g0, genotype& g1) const {
         if (std::min(g0.size(), g1.size()) < start_ + length_) {
           throw
             std::logic_error{"iterative_recombination_on_range: size mismatch"};
@@ -157,7 +164,9 @@ namespace libbear {
     population operator()(const genotype& g) const {
       genotype g_res{g};
       (base<Ts>::operator()(g_res), ...);
-      return population{g_res};
+      population res{};
+      res.push_back(std::move(g_res));
+      return res;
     }
   };
 
@@ -190,7 +199,12 @@ namespace libbear {
       genotype g1_res{g1};
       (base<Ts>::operator()(g0_res, g1_res), ...);
       assert(N != 1 || g0_res == g1_res);
-      return N == 1? population{g0_res} : population{g0_res, g1_res};
+      population res{};
+      res.push_back(std::move(g0_res));
+      if constexpr (N == 2) {
+        res.push_back(std::move(g1_res));
+      }
+      return res;
     }
   };
 
@@ -217,16 +231,18 @@ namespace libbear {
   public:
     explicit Gaussian_mutation(T sigma) : sigma_{sigma} {}
 
-    population operator()(const genotype& g) {
-      using type = typename iterative_mutation<T>::arg_t<T>;
-      return iterative_mutation<T>{
-        type{[this, n = random_from_normal_distribution<T>](const gene<T>& a) {
-          const T res = a.constraints().clamp(a.value() + sigma_ * n(0., 1.));
-          return std::tuple<gene<T>>{gene<T>{res, a.constraints()}};
-        },
-        0,
-        g.size()}
-      }(g);
+    population operator()(const genotype& g) const {
+      // All the variates are drawn at once, see fill_from_normal_distribution.
+      std::vector<T> n(g.size());
+      fill_from_normal_distribution<T>(n, 0., 1.);
+      genotype g_res{g};
+      for (std::size_t i = 0; i < g_res.size(); ++i) {
+        auto& a = *static_cast<gene<T>*>(g_res[i]);
+        a.value(a.constraints().clamp(a.value() + sigma_ * n[i]));
+      }
+      population res{};
+      res.push_back(std::move(g_res));
+      return res;
     }
 
   private:
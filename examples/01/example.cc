@@ -47,14 +47,14 @@ int main() {
   const std::size_t generation_sz{1000};
   const std::size_t parents_sz{42};
   const generation_creator::options o{v, generation_sz, parents_sz};
-  const generation_creator gc{p, o};
+  const generation_creator gc{p, o, ff};
   const auto tc = max_iterations_termination(100);
   const evolution e{gc, tc};
 
   std::ofstream file{"evolution.dat"};
   for (std::size_t i = 0; const auto& x : e()) {
     for (const auto& xx : x) {
-      file << i << ' ' << xx[0]->value<type>() << '\n';
+      file << i << ' ' << xx.g[0]->value<type>() << '\n';
     }
     ++i;
   }
@@ -52,7 +52,7 @@ int main() {
   const std::size_t generation_sz{1000};
   const std::size_t parents_sz{42};
   const generation_creator::options o{v, generation_sz, parents_sz};
-  const generation_creator gc{p, o};
+  const generation_creator gc{p, o, ff};
   const auto tc = max_fitness_improvement_termination(ff, 10, 0.05);
   const evolution e{gc, tc};
 
@@ -60,8 +60,8 @@ int main() {
   for (std::size_t i = 0; const auto& x : e()) {
     for (const auto& xx : x) {
       file << i << ' '
-           << xx[0]->value<type>() << ' '
-           << xx[1]->value<type>() << '\n';
+           << xx.g[0]->value<type>() << ' '
+           << xx.g[1]->value<type>() << '\n';
     }
     ++i;
   }
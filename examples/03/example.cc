@@ -4,12 +4,15 @@
 // - variation type: Gaussian mutation and arithmetic recombination
 
 #include <atomic>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <iomanip>
 #include <numbers>
 #include <fstream>
+#include <optional>
 #include <sstream>
+#include <string>
 #include <type_traits>
 #include <libbear/core/range.h>
 #include <libbear/core/system.h>
@@ -58,6 +61,16 @@ namespace {
     return oss.str();
   }
 
+  // Total energy printed by calc.sh, none if output is not a number.
+  std::optional<double> energy(const std::string& output) {
+    std::istringstream iss{output};
+    double res{};
+    if (iss >> res && (iss >> std::ws).eof()) {
+      return res;
+    }
+    return std::nullopt;
+  }
+
 }
 
 int main() {
@@ -69,8 +82,11 @@ int main() {
   const auto f = [](type distance, type angle) -> fitness {
     const std::string input_filename{unique_filename()};
     input_file(input_filename, distance, angle);
-    const auto [o, e] = execute("/bin/bash calc.sh " + input_filename);
-    return o == "Calculations failed.\n"? incalculable : -std::stod(o);
+    // Stalled SCF calculations are killed and their fitness is incalculable.
+    const auto [o, e] = execute("/bin/bash calc.sh " + input_filename,
+                                {.timeout = std::chrono::minutes{30}});
+    const auto x = energy(o);
+    return x? -*x : incalculable;
   };
   // domain
   const range<type> distance_range{0.5, 2.5}; // Angstrom
@@ -101,18 +117,17 @@ int main() {
   const std::size_t generation_sz{1000};
   const std::size_t parents_sz{42};
   const generation_creator::options o{v, generation_sz, parents_sz};
-  const generation_creator gc{p, o};
+  const generation_creator gc{p, o, ff};
   const auto tc = max_fitness_improvement_termination(ff, 10, 0.05);
   const evolution e{gc, tc};
 
   std::ofstream file{"evolution.dat"};
-  for (std::size_t i = 0; const auto& x : e()) {
+  e([&](std::size_t i, const evaluated_population& x) {
     for (const auto& xx : x) {
       file << i << ' '
-           << xx[0]->value<type>() << ' '
-           << xx[1]->value<type>() << ' '
-           << ff(xx) << '\n';
+           << xx.g[0]->value<type>() << ' '
+           << xx.g[1]->value<type>() << ' '
+           << xx.f << '\n';
     }
-    ++i;
-  }
+  }, 1);
 }
@@ -0,0 +1,107 @@
+// Benchmark of genotype hash used by fitness function cache
+// - collisions: number of distinct hashes over real-valued populations
+// - throughput: time of first (calculated) and next (cached) hash of
+//   genotype and time of lookup in cache of fitness values, timed directly
+//   rather than through fitness_function, which prints debug messages
+//   unless the library is built with NDEBUG
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <libbear/core/cache.h>
+#include <libbear/core/range.h>
+#include <libbear/ea/elements.h>
+#include <libbear/ea/genotype.h>
+#include <libbear/ea/population.h>
+
+using namespace libbear;
+
+namespace {
+
+  using type = double;
+  const range<type> d{-10., +10.};
+
+  // Grid of n x n genotypes with step s, contains pairs (x, y) and (y, x).
+  population grid(std::size_t n, type s) {
+    population res{};
+    res.reserve(n * n);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        res.push_back(genotype{gene{d.min() + i * s, d},
+                               gene{d.min() + j * s, d}});
+      }
+    }
+    return res;
+  }
+
+  population random(std::size_t n, std::size_t genes) {
+    genotype g{};
+    for (std::size_t i = 0; i < genes; ++i) {
+      g.push_back(gene{d});
+    }
+    population res(n, g);
+    for (auto& x : res) {
+      x.random_reset();
+    }
+    return res;
+  }
+
+  void collisions(const std::string& name, const population& p) {
+    std::unordered_set<std::size_t> hs{};
+    std::unordered_set<genotype> gs{};
+    for (const auto& g : p) {
+      hs.insert(std::hash<genotype>{}(g));
+      gs.insert(g);
+    }
+    std::cout << name << ": " << gs.size() << " distinct genotypes, "
+              << hs.size() << " distinct hashes\n";
+  }
+
+  template<typename F>
+  double ns_per_genotype(const population& p, std::size_t rounds, F f) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < rounds; ++i) {
+      f();
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count()
+      / rounds / p.size();
+  }
+
+  void throughput(const std::string& name, const population& p) {
+    const std::size_t rounds{20};
+    const auto hash_all = [&]() {
+      for (const auto& g : p) {
+        std::hash<genotype>{}(g);
+      }
+    };
+    const double first = ns_per_genotype(p, 1, hash_all);
+    const double next = ns_per_genotype(p, rounds, hash_all);
+    // Cache of the same type as the one of fitness_function.
+    concurrent_cache<genotype, fitness> db{};
+    for (const auto& g : p) {
+      db.insert(g, g[0]->value<type>());
+    }
+    const double lookup = ns_per_genotype(p, rounds, [&]() {
+      for (const auto& g : p) {
+        db.find(g);
+      }
+    });
+    std::cout << name << ": first hash " << first << " ns, next hash "
+              << next << " ns, cache lookup " << lookup << " ns\n";
+  }
+
+} // namespace
+
+int main() {
+  collisions("grid 200 x 200, step 0.1", grid(200, 0.1));
+  collisions("grid 1000 x 1000, step 0.02", grid(1000, 0.02));
+  collisions("random, 2 genes", random(1000000, 2));
+  collisions("random, 20 genes", random(100000, 20));
+
+  throughput("random, 2 genes", random(100000, 2));
+  throughput("random, 20 genes", random(100000, 20));
+}
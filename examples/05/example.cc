@@ -0,0 +1,86 @@
+// Benchmark of concurrent fitness cache lookups
+// - uncontended: one thread looking up cached genotypes
+// - contended: several threads looking up the same cached genotypes at once
+// - shards: one shard (single lock) against default number of shards
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <libbear/core/cache.h>
+#include <libbear/core/range.h>
+#include <libbear/ea/fitness.h>
+#include <libbear/ea/genotype.h>
+#include <libbear/ea/population.h>
+
+using namespace libbear;
+
+namespace {
+
+  using type = double;
+  using database = concurrent_cache<genotype, fitness>;
+
+  const range<type> d{-10., +10.};
+  const std::size_t rounds{20};
+
+  population random(std::size_t n) {
+    population res(n, genotype{gene{d}, gene{d}});
+    for (auto& x : res) {
+      x.random_reset();
+    }
+    return res;
+  }
+
+  // Wall time per lookup, i.e. inverse of total throughput of threads.
+  double ns_per_lookup(database& db, const population& p, std::size_t threads) {
+    const auto lookup_all = [&db, &p]() {
+      for (std::size_t i = 0; i < rounds; ++i) {
+        for (const auto& g : p) {
+          if (!db.find(g)) {
+            std::cerr << "missing genotype\n";
+          }
+        }
+      }
+    };
+    const auto t0 = std::chrono::steady_clock::now();
+    {
+      std::vector<std::jthread> ts{};
+      for (std::size_t i = 0; i < threads; ++i) {
+        ts.emplace_back(lookup_all);
+      }
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count()
+      / (rounds * p.size() * threads);
+  }
+
+  void lookups(const std::string& name, std::size_t shards,
+               const population& p) {
+    database db{cache_options{},
+                [](const genotype& g, fitness) { return g.footprint(); },
+                shards};
+    for (const auto& g : p) {
+      db.insert(g, g[0]->value<type>());
+    }
+    std::cout << name << " (" << db.shards() << " shards):";
+    for (const std::size_t threads : {1, 2, 4, 8}) {
+      std::cout << ' ' << threads << " threads "
+                << ns_per_lookup(db, p, threads) << " ns";
+    }
+    std::cout << '\n';
+  }
+
+} // namespace
+
+int main() {
+  std::cout << "hardware threads: " << std::thread::hardware_concurrency()
+            << '\n';
+  const population small{random(1000)};
+  const population large{random(100000)};
+  lookups("1000 genotypes", 1, small);
+  lookups("1000 genotypes", database::default_shards, small);
+  lookups("100000 genotypes", 1, large);
+  lookups("100000 genotypes", database::default_shards, large);
+}